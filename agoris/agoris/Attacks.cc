@@ -0,0 +1,287 @@
+// Attacks.cc - source file for the Agoris program
+// Copyright (c) 2001  Andreas Bauer <baueran@in.tum.de>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+// USA.
+
+extern "C" {
+#include <stdlib.h>
+#include <string.h>
+}
+#include "Attacks.hh"
+#include "Board.hh"
+
+namespace brd {
+
+  Magic rookMagics[64];
+  Magic bishopMagics[64];
+  int attackBackend = ATTACKS_MAGIC;
+
+  // One bit per square, as a constant table that needs no initialisation at run time
+#define SQUARE_MASKS(r) \
+  (BitBoard)1 << ((r) * 8), (BitBoard)1 << ((r) * 8 + 1), (BitBoard)1 << ((r) * 8 + 2), (BitBoard)1 << ((r) * 8 + 3), \
+  (BitBoard)1 << ((r) * 8 + 4), (BitBoard)1 << ((r) * 8 + 5), (BitBoard)1 << ((r) * 8 + 6), (BitBoard)1 << ((r) * 8 + 7)
+
+  const BitBoard squareMask[64] = {
+    SQUARE_MASKS(0), SQUARE_MASKS(1), SQUARE_MASKS(2), SQUARE_MASKS(3),
+    SQUARE_MASKS(4), SQUARE_MASKS(5), SQUARE_MASKS(6), SQUARE_MASKS(7)
+  };
+
+  BitBoard knightAttacks[64];
+  BitBoard kingAttacks[64];
+  BitBoard pawnAttacks[2][64];
+  BitBoard betweenSquares[64][64];
+  BitBoard lineSquares[64][64];
+
+  // Attack tables for all squares, indexed through the Magic entries above
+  static BitBoard rookTable[102400];
+  static BitBoard bishopTable[5248];
+
+#ifdef HAVE_PEXT
+  // The same attacks, in PEXT index order. Only filled if the CPU supports BMI2.
+  static BitBoard rookPextTable[102400];
+  static BitBoard bishopPextTable[5248];
+#endif
+
+  static const BitBoard rookMagicNumbers[64] = {
+    0x1080004008801020ULL, 0x0840092002c03000ULL, 0x1900200010400900ULL, 0x0880100008000480ULL,
+    0x4200100420080200ULL, 0x8100020100080400ULL, 0x0200040110886200ULL, 0x0200008040220411ULL,
+    0x0404800084400220ULL, 0x0000401000402000ULL, 0x0086001081220440ULL, 0x0408800800100280ULL,
+    0x000a001201040820ULL, 0x8848800200840080ULL, 0x4001000100040200ULL, 0x0442000102105084ULL,
+    0x9080010020804100ULL, 0x0040404000201009ULL, 0x0000808010002009ULL, 0x2200090021d00100ULL,
+    0x0008008008040080ULL, 0x0004004002010040ULL, 0x0011040008015042ULL, 0x00000a0001768104ULL,
+    0x0000800080204009ULL, 0x2010004140002001ULL, 0x9800200280100080ULL, 0x1000100080080080ULL,
+    0x0442000a00049020ULL, 0x2100040080020080ULL, 0x0800120400900148ULL, 0x0010040a00128541ULL,
+    0x2800804000800030ULL, 0x1010002000400041ULL, 0x4000200011004100ULL, 0x0610008410800800ULL,
+    0x0400802402800800ULL, 0xc100020080800400ULL, 0x0002000802000401ULL, 0x0182085882000401ULL,
+    0x0220204000808000ULL, 0x2860100040024022ULL, 0x0001002004110040ULL, 0x99101042000a0020ULL,
+    0x0004080004008080ULL, 0x0010040002008080ULL, 0x2012004881020004ULL, 0x8300842444820011ULL,
+    0x0088403882010200ULL, 0x0820400080210100ULL, 0x0110910040a00300ULL, 0x0801100280080480ULL,
+    0x0242009008200600ULL, 0x1002000489500200ULL, 0x0040800200010080ULL, 0x0091800041000080ULL,
+    0x0000209300488001ULL, 0x04c1002414824001ULL, 0x020020000b001041ULL, 0x7000100004200901ULL,
+    0x8002002004100802ULL, 0x30010002084c0007ULL, 0x0888221800813004ULL, 0x4000002840840112ULL
+  };
+
+  static const BitBoard bishopMagicNumbers[64] = {
+    0xa010041108003100ULL, 0x006082020a002900ULL, 0x6810010619200000ULL, 0x08281a0520000408ULL,
+    0x0001104001000400ULL, 0x0018901008048400ULL, 0x00040a0210245280ULL, 0x000200210808a402ULL,
+    0x9140048410821200ULL, 0x0800091010820041ULL, 0x20504804832202c0ULL, 0x0100091401081000ULL,
+    0x8021011140000012ULL, 0x0810020804450400ULL, 0x208b0542109008a2ULL, 0x0080084a08040204ULL,
+    0x0040e2a80811244cULL, 0x2505022008008108ULL, 0x0430220100420040ULL, 0x010a040420220040ULL,
+    0x1105000290400000ULL, 0x0093001200822120ULL, 0x4000a62048043004ULL, 0x280120048a015004ULL,
+    0x006090002a020814ULL, 0x44042000240800d0ULL, 0x01102800040a4400ULL, 0x1004080080220040ULL,
+    0x0001001011004024ULL, 0x0010044000805040ULL, 0x0914041200820100ULL, 0x0004821012821480ULL,
+    0x0024040500c05021ULL, 0x0088611002080200ULL, 0x0116080a00040020ULL, 0x4000020080080080ULL,
+    0x2450450140840040ULL, 0x0000880201484100ULL, 0x0222020404020092ULL, 0x8081110600002e00ULL,
+    0x2842101105000801ULL, 0x1100809008001025ULL, 0x00020202221c0400ULL, 0x0422014022009020ULL,
+    0x0210046102100c00ULL, 0xc004008082029102ULL, 0x00aa461801101200ULL, 0x0404080080201108ULL,
+    0x020542108c205002ULL, 0x0410544804100100ULL, 0x0040910841100000ULL, 0x0400200042021100ULL,
+    0x00004204850400c0ULL, 0x0200100410a42102ULL, 0x1040020801210102ULL, 0x0805040410420000ULL,
+    0x2884804130100200ULL, 0x800c262201242000ULL, 0x1058000194108800ULL, 0x0014221054420204ULL,
+    0x0104000012a02200ULL, 0x0200881003300100ULL, 0x0140400202840100ULL, 0x0402020801010201ULL
+  };
+
+  static const int rookDir[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+  static const int bishopDir[4][2] = { { -1, -1 }, { -1, 1 }, { 1, -1 }, { 1, 1 } };
+  static const int knightStep[8][2] = { { -2, -1 }, { -2, 1 }, { -1, -2 }, { -1, 2 }, { 1, -2 }, { 1, 2 }, { 2, -1 }, { 2, 1 } };
+  static const int kingStep[8][2] = { { -1, -1 }, { -1, 0 }, { -1, 1 }, { 0, -1 }, { 0, 1 }, { 1, -1 }, { 1, 0 }, { 1, 1 } };
+  // White pawns move towards row 0, black pawns towards row 7
+  static const int whitePawnStep[2][2] = { { -1, -1 }, { -1, 1 } };
+  static const int blackPawnStep[2][2] = { { 1, -1 }, { 1, 1 } };
+
+
+  //! Compute slider attacks the slow way, by walking every ray until it hits a piece or the border.
+  /** This is only used to fill the attack tables when the library is loaded.
+   *  @param sq is the location of the slider
+   *  @param occ is the bit board of occupied squares
+   *  @param dir are the four row/column steps of the slider
+   *  @param edges if false, leave out the last square of every ray (which never blocks anything)
+   *  @return The bit board of attacked squares
+   */
+  static BitBoard slidingAttacks(int sq, BitBoard occ, const int dir[4][2], bool edges) {
+    BitBoard attacks = 0, bit = 1;
+
+    for (int d = 0; d < 4; d++) {
+      int row = ROW(sq) + dir[d][0], col = COL(sq) + dir[d][1];
+
+      while (row >= 0 && row < 8 && col >= 0 && col < 8) {
+	if (!edges) {
+	  int nextRow = row + dir[d][0], nextCol = col + dir[d][1];
+	  if (nextRow < 0 || nextRow > 7 || nextCol < 0 || nextCol > 7)
+	    break;
+	}
+	attacks |= bit << (row * 8 + col);
+	if (occ & (bit << (row * 8 + col)))
+	  break;
+	row += dir[d][0];
+	col += dir[d][1];
+      }
+    }
+
+    return attacks;
+  }
+
+
+  //! Compute the squares reached from sq by each of the given row/column steps, leaving out those off the board.
+  static BitBoard leaperAttacks(int sq, const int step[][2], int steps) {
+    BitBoard attacks = 0, bit = 1;
+
+    for (int i = 0; i < steps; i++) {
+      int row = ROW(sq) + step[i][0], col = COL(sq) + step[i][1];
+      if (row >= 0 && row < 8 && col >= 0 && col < 8)
+	attacks |= bit << (row * 8 + col);
+    }
+
+    return attacks;
+  }
+
+
+  //! Gather the bits of occ selected by mask into the low bits of the result, like the PEXT instruction does.
+  static BitBoard softPext(BitBoard occ, BitBoard mask) {
+    BitBoard result = 0, bit = 1;
+
+    for (; mask; mask &= mask - 1, bit <<= 1)
+      if (occ & mask & -mask)
+	result |= bit;
+
+    return result;
+  }
+
+
+  //! Fill the magic entries and attack tables for one kind of slider.
+  /** @param pextTable if not 0, is filled with the attacks in PEXT index order, too
+   */
+  static void initMagics(Magic* magics, BitBoard* table, BitBoard* pextTable, const BitBoard* magicNumbers, const int dir[4][2]) {
+    BitBoard* attacks = table;
+    BitBoard* pextAttacks = pextTable;
+
+    for (int sq = 0; sq < 64; sq++) {
+      Magic& m = magics[sq];
+      int bits = 0;
+
+      m.mask = slidingAttacks(sq, 0, dir, false);
+      m.magic = magicNumbers[sq];
+      m.attacks = attacks;
+      m.pextAttacks = pextAttacks;
+      for (BitBoard b = m.mask; b; b &= b - 1)
+	bits++;
+      m.shift = 64 - bits;
+
+      // Walk all subsets of the mask (Carry-Rippler) and store their attack sets
+      BitBoard occ = 0;
+      do {
+	m.attacks[(occ * m.magic) >> m.shift] = slidingAttacks(sq, occ, dir, true);
+	if (pextAttacks)
+	  m.pextAttacks[softPext(occ, m.mask)] = m.attacks[(occ * m.magic) >> m.shift];
+	occ = (occ - m.mask) & m.mask;
+      } while (occ);
+
+      attacks += (BitBoard)1 << bits;
+      if (pextAttacks)
+	pextAttacks += (BitBoard)1 << bits;
+    }
+  }
+
+
+  //! Set up all attack tables and pick the backend. This is done once when the library is loaded.
+  /** PEXT is chosen whenever CPUID reports BMI2. Since PEXT is microcoded and slow on some CPUs, the
+   *  environment variable AGORIS_ATTACKS can be set to "magic" or "pext" to override the choice.
+   */
+  void initAttacks(void) {
+    BitBoard *rookPext = 0, *bishopPext = 0;
+    const char* backend = getenv("AGORIS_ATTACKS");
+
+#ifdef HAVE_PEXT
+    if (isPextSupported()) {
+      rookPext = rookPextTable;
+      bishopPext = bishopPextTable;
+    }
+#endif
+
+    initMagics(rookMagics, rookTable, rookPext, rookMagicNumbers, rookDir);
+    initMagics(bishopMagics, bishopTable, bishopPext, bishopMagicNumbers, bishopDir);
+
+    for (int sq = 0; sq < 64; sq++) {
+      knightAttacks[sq] = leaperAttacks(sq, knightStep, 8);
+      kingAttacks[sq] = leaperAttacks(sq, kingStep, 8);
+      pawnAttacks[WHITE][sq] = leaperAttacks(sq, whitePawnStep, 2);
+      pawnAttacks[BLACK][sq] = leaperAttacks(sq, blackPawnStep, 2);
+    }
+
+    // Squares between and lines through every pair of squares on a common row, column or diagonal
+    for (int s1 = 0; s1 < 64; s1++) {
+      for (int s2 = 0; s2 < 64; s2++) {
+	BitBoard both = ((BitBoard)1 << s1) | ((BitBoard)1 << s2);
+
+	betweenSquares[s1][s2] = 0;
+	lineSquares[s1][s2] = 0;
+	if (s1 == s2)
+	  continue;
+
+	if (rookAttacks<ATTACKS_MAGIC>(s1, 0) & ((BitBoard)1 << s2)) {
+	  betweenSquares[s1][s2] = rookAttacks<ATTACKS_MAGIC>(s1, both) & rookAttacks<ATTACKS_MAGIC>(s2, both);
+	  lineSquares[s1][s2] = (rookAttacks<ATTACKS_MAGIC>(s1, 0) & rookAttacks<ATTACKS_MAGIC>(s2, 0)) | both;
+	}
+	else if (bishopAttacks<ATTACKS_MAGIC>(s1, 0) & ((BitBoard)1 << s2)) {
+	  betweenSquares[s1][s2] = bishopAttacks<ATTACKS_MAGIC>(s1, both) & bishopAttacks<ATTACKS_MAGIC>(s2, both);
+	  lineSquares[s1][s2] = (bishopAttacks<ATTACKS_MAGIC>(s1, 0) & bishopAttacks<ATTACKS_MAGIC>(s2, 0)) | both;
+	}
+      }
+    }
+
+    if ((backend && strcmp(backend, "magic") == 0) || !setAttackBackend(ATTACKS_PEXT))
+      setAttackBackend(ATTACKS_MAGIC);
+  }
+
+
+  //! Return true if this CPU can use the PEXT backend.
+  bool isPextSupported(void) {
+#ifdef HAVE_PEXT
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("bmi2");
+#else
+    return false;
+#endif
+  }
+
+
+  //! Select how slider attacks are looked up.
+  /** The Board members that look up slider attacks test the backend once, when they are called, and run the
+   *  instance of their code for it.
+   *  @param backend is either ATTACKS_MAGIC or ATTACKS_PEXT
+   *  @return false if the backend is not available on this CPU, in which case nothing changes
+   */
+  bool setAttackBackend(int backend) {
+    if (backend == ATTACKS_PEXT && !isPextSupported())
+      return false;
+
+    attackBackend = backend;
+    return true;
+  }
+
+
+  //! Return the backend currently used for slider attacks (ATTACKS_MAGIC or ATTACKS_PEXT).
+  int getAttackBackend(void) {
+    return attackBackend;
+  }
+
+
+  // Make sure the tables are ready before anyone asks for attacks
+  static class AttacksInit {
+  public:
+    AttacksInit() { initAttacks(); }
+  } attacksInit;
+
+}
@@ -0,0 +1,151 @@
+// Attacks.hh - source file for the Agoris program
+// Copyright (c) 2001  Andreas Bauer <baueran@in.tum.de>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+// USA.
+
+#ifndef __ATTACKS_HH_
+#define __ATTACKS_HH_
+
+extern "C" {
+#include <sys/types.h>
+}
+
+// PEXT indexing is only available with GCC on x86-64, and only used if the CPU has BMI2
+#if defined(__GNUC__) && defined(__x86_64__)
+#define HAVE_PEXT 1
+#include <immintrin.h>
+
+// A function that runs the PEXT instance of a template: it is compiled for BMI2, and everything it calls is
+// inlined into it, so the PEXT lookups are inlined as well
+#define PEXT_INSTANCE __attribute__ ((target ("bmi2"), flatten))
+#endif
+
+#define ATTACKS_MAGIC 0
+#define ATTACKS_PEXT  1
+
+namespace brd {
+
+  typedef u_int64_t BitBoard;
+
+  //! Everything needed to look up the attacks of a slider on one square.
+  /** The relevant occupancy (mask) is multiplied with the magic number and the top bits of the product,
+   *  shifted down by shift, index into the attack table of that square.
+   *  On CPUs with BMI2 a second table, pextAttacks, is indexed by extracting the mask bits of the occupancy
+   *  with a single PEXT instruction instead.
+   */
+  class Magic {
+  public:
+    BitBoard mask;
+    BitBoard magic;
+    BitBoard* attacks;
+    BitBoard* pextAttacks;
+    unsigned int shift;
+  };
+
+  extern Magic rookMagics[64];
+  extern Magic bishopMagics[64];
+  extern int attackBackend;
+
+  // The bit of every square, shared by Board and Eval
+  extern const BitBoard squareMask[64];
+
+  // Squares attacked by a knight, a king or a pawn of either colour (indexed by WHITE/BLACK) on a square
+  extern BitBoard knightAttacks[64];
+  extern BitBoard kingAttacks[64];
+  extern BitBoard pawnAttacks[2][64];
+
+  // Squares strictly between two squares, and the whole line through them, if they share a row, column or diagonal
+  extern BitBoard betweenSquares[64][64];
+  extern BitBoard lineSquares[64][64];
+
+  void initAttacks(void);
+  bool setAttackBackend(int);
+  int getAttackBackend(void);
+  bool isPextSupported(void);
+
+  //! Return all squares a rook on sq attacks, given the occupied squares occ.
+  /** The backend is a template parameter, so the lookup is inlined into its caller. Code that looks up slider
+   *  attacks is a template on the backend as well, and attackBackend picks the instance to run just once,
+   *  at its entry point. This is the multiply-shift lookup of ATTACKS_MAGIC.
+   */
+  template<int Backend> inline BitBoard rookAttacks(int sq, BitBoard occ) {
+    const Magic& m = rookMagics[sq];
+    return m.attacks[((occ & m.mask) * m.magic) >> m.shift];
+  }
+
+  //! Return all squares a bishop on sq attacks, given the occupied squares occ, using multiply-shift indexing.
+  template<int Backend> inline BitBoard bishopAttacks(int sq, BitBoard occ) {
+    const Magic& m = bishopMagics[sq];
+    return m.attacks[((occ & m.mask) * m.magic) >> m.shift];
+  }
+
+#ifdef HAVE_PEXT
+  //! Return all squares a rook on sq attacks, using BMI2 PEXT indexing. Only inlined into PEXT_INSTANCE code.
+  template<> inline __attribute__ ((target ("bmi2"))) BitBoard rookAttacks<ATTACKS_PEXT>(int sq, BitBoard occ) {
+    return rookMagics[sq].pextAttacks[_pext_u64(occ, rookMagics[sq].mask)];
+  }
+
+  //! Return all squares a bishop on sq attacks, using BMI2 PEXT indexing. Only inlined into PEXT_INSTANCE code.
+  template<> inline __attribute__ ((target ("bmi2"))) BitBoard bishopAttacks<ATTACKS_PEXT>(int sq, BitBoard occ) {
+    return bishopMagics[sq].pextAttacks[_pext_u64(occ, bishopMagics[sq].mask)];
+  }
+#endif
+
+  //! Return all squares a queen on sq attacks, given the occupied squares occ.
+  template<int Backend> inline BitBoard queenAttacks(int sq, BitBoard occ) {
+    return rookAttacks<Backend>(sq, occ) | bishopAttacks<Backend>(sq, occ);
+  }
+
+  //! Return the index of the least significant bit set in a non-empty bit board.
+  /** Without GCC the isolated bit is multiplied with a De Bruijn sequence, whose top six bits are then
+   *  different for every bit position.
+   */
+  inline int firstBit(BitBoard b) {
+#ifdef __GNUC__
+    return __builtin_ctzll(b);
+#else
+    static const int index[64] = {
+       0, 47,  1, 56, 48, 27,  2, 60, 57, 49, 41, 37, 28, 16,  3, 61,
+      54, 58, 35, 52, 50, 42, 21, 44, 38, 32, 29, 23, 17, 11,  4, 62,
+      46, 55, 26, 59, 40, 36, 15, 53, 34, 51, 20, 43, 31, 22, 10, 45,
+      25, 39, 14, 33, 19, 30,  9, 24, 13, 18,  8, 12,  7,  6,  5, 63
+    };
+    return index[((b ^ (b - 1)) * (BitBoard)0x03f79d71b4cb0a89ULL) >> 58];
+#endif
+  }
+
+  //! Return the index of the least significant bit set in a non-empty bit board and clear that bit.
+  inline int popFirstBit(BitBoard& b) {
+    int sq = firstBit(b);
+    b &= b - 1;
+    return sq;
+  }
+
+  //! Return the number of bits set in a bit board.
+  inline int popCount(BitBoard b) {
+#ifdef __GNUC__
+    return __builtin_popcountll(b);
+#else
+    b = b - ((b >> 1) & (BitBoard)0x5555555555555555ULL);
+    b = (b & (BitBoard)0x3333333333333333ULL) + ((b >> 2) & (BitBoard)0x3333333333333333ULL);
+    b = (b + (b >> 4)) & (BitBoard)0x0f0f0f0f0f0f0f0fULL;
+    return (int)((b * (BitBoard)0x0101010101010101ULL) >> 56);
+#endif
+  }
+
+}
+
+#endif
@@ -21,7 +21,7 @@
 #include <vector>
 extern "C" {
 #include <stdlib.h>
-#include <math.h>
+#include <ctype.h>
 }
 #include "Board.hh"
 
@@ -29,18 +29,17 @@ using namespace std;
 
 namespace brd {
 
-  /// Constructor, set original and destination locations to zero.
-  BitBoardMove::BitBoardMove() {
-    source = 0; dest = 0;
-    score = 0;
-  }
-
   /// Constructor, set location values to zero.
   Location::Location() {
     x = 0;
     y = 0;
   }
 
+  /// Constructor, a pawn on the last row is promoted to a queen unless told otherwise.
+  Move::Move() {
+    promotionPiece = QUEEN;
+  }
+
   /// Returns the original location of a moved piece.
   Location Move::source(void) {
     return from;
@@ -56,172 +55,604 @@ namespace brd {
     from = newPos;
   }
 
+  /// Returns the piece a pawn is promoted to, if the move is a promotion.
+  int Move::promotion(void) {
+    return promotionPiece;
+  }
+
   /// Sets the new location of a moved piece.
   void Move::setDest(Location newPos) {
     to = newPos;
   }
 
+  /// Sets the piece (KNIGHT ... QUEEN) a pawn is promoted to, if the move is a promotion.
+  void Move::setPromotion(int piece) {
+    promotionPiece = piece;
+  }
+
+
+  //! Set up the position at the start of a game, with its hash keys.
+  static Position newGamePosition(void) {
+    Position pos;
+
+    for (int i = 0; i < 6; i++)
+      pos.pieces[i] = 0;
+    pos.colors[WHITE] = 0; pos.colors[BLACK] = 0;
+    pos.castling = CASTLING_WHITE_WEST | CASTLING_WHITE_EAST | CASTLING_BLACK_WEST | CASTLING_BLACK_EAST;
+    pos.hash = zobristCastling[pos.castling]; pos.pawnHash = 0;
+
+    for (int i = 0; i < 64; i++) {
+      pos.square[i].setColor(initColor[i]);
+      pos.square[i].setPiece(initPiece[i]);
+
+      if (initColor[i] != EMPTY) {
+	pos.pieces[initPiece[i]] |= squareMask[i];
+	pos.colors[initColor[i]] |= squareMask[i];
+	pos.hash ^= zobristPieces[initColor[i]][initPiece[i]][i];
+	if (initPiece[i] == PAWN)
+	  pos.pawnHash ^= zobristPieces[initColor[i]][PAWN][i];
+      }
+    }
+
+    pos.side = WHITE;
+    pos.epSquare = NO_SQUARE;
+
+    return pos;
+  }
+
 
   /// The constructor initializes the chess board.
+  /** The start position is set up only once and then copied, so a board is cheap to create.
+   */
   Board::Board() {
+    static const Position startPosition = newGamePosition();
+
     // Few init values first
-    curPos.whiteCastlingWest = true; curPos.whiteCastlingEast = true; curPos.blackCastlingWest = true; curPos.blackCastlingEast = true;
-    checks = 0; checkmate = EMPTY; curTurn = WHITE; promotions = 0;
-    curPos.whitePawns = 0; curPos.whiteRooks = 0; curPos.whiteKnights = 0; curPos.whiteBishops = 0;
-    curPos.whiteQueens = 0; curPos.whiteKing = 0; curPos.whitePieces = 0;
-    curPos.blackPawns = 0; curPos.blackRooks = 0; curPos.blackKnights = 0; curPos.blackBishops = 0;
-    curPos.blackQueens = 0; curPos.blackKing = 0; curPos.blackPieces = 0;
+    checks = 0; checkmate = EMPTY; promotions = 0;
+    stalemate = false;
+    bestMove = PackedMove(0, 0);
 
     // Set up default piece values
     pawnVal = 1; knightVal = 3; bishVal = 3.5;
     rookVal = 5; queenVal = 10; kingVal = 10000;
     infVal = 10000000;
 
-    // Setup the mask and safetyBoard
-    BitBoard bit = 1;
-    for (unsigned long i = 0; i < 64; i++) {
-      mask[i] = bit << i;
+    for (int i = 0; i < 64; i++)
       safetyBoard[i] = 0;
-    }
-    
-    // Setup the board
-    for (int i = 0; i < 64; i++) {
-      curPos.square[i].setColor(initColor[i]);
-      curPos.square[i].setPiece(initPiece[i]);
-    }
-  
-    // Initialize bit boards
-    for (int i = 0; i < 64; i++) {
-      if (curPos.square[i].getColor() == WHITE) {
-	curPos.whitePieces |= mask[i];
 
-	switch (curPos.square[i].getPiece()) {
-	case PAWN:
-	  curPos.whitePawns |= mask[i];
-	  break;
-	case ROOK:
-	  curPos.whiteRooks |= mask[i];
-	  break;
-	case KNIGHT:
-	  curPos.whiteKnights |= mask[i];
-	  break;
-	case BISHOP:
-	  curPos.whiteBishops |= mask[i];
-	  break;
-	case QUEEN:
-	  curPos.whiteQueens |= mask[i];
-	  break;
-	case KING:
-	  curPos.whiteKing |= mask[i];
-	  break;
-	}
-      }
-      else if (curPos.square[i].getColor() == BLACK) {
-	curPos.blackPieces |= mask[i];
-	
-	switch (curPos.square[i].getPiece()) {
-	case PAWN:
-	  curPos.blackPawns |= mask[i];
-	  break;
-	case ROOK:
-	  curPos.blackRooks |= mask[i];
-	  break;
-	case KNIGHT:
-	  curPos.blackKnights |= mask[i];
-	  break;
-	case BISHOP:
-	  curPos.blackBishops |= mask[i];
-	  break;
-	case QUEEN:
-	  curPos.blackQueens |= mask[i];
-	  break;
-	case KING:
-	  curPos.blackKing |= mask[i];
-	  break;
-	}
-      }
-    }
+    curPos = startPosition;
   }
 
 
   //! Generate all pseudo-legal positions for the side that is about to make a move.
+  /** This method creates all the pseudo-legal moves for the chess board and the side which is about to make a move
+   *  and stores them in the board's own move list.
+   *  @see genMoves(MoveList&)
+   *  @see getMoves()
+   */
+  void Board::genMoves(void) {
+    genMoves(allMoves);
+  }
+
+
+  //! Generate all pseudo-legal positions for the side that is about to make a move into a given move list.
   /** This method creates all the pseudo-legal moves for the chess board and the side which is about to make a move.
    *  When it has finished move generation the flags for checkmate, number of possible checks and the safety-board will be set.
+   *  @param moves is cleared and then filled with the generated moves
    *  @see getTurn()
    *  @see isCheckSituation()
    *  @see getChecks()
    *  @see getSafetyBoard()
    */
-  void Board::genMoves(void) {
-    vector<BitBoardMove> moveSet;
-    allMoves.clear();                    // Clear the list of possible moves available for this particular board
-    promotions = 0;                      // Clear the number of possible pawn promotions
-    checks = 0;                          // Clear the number of possible check situations for this particular board
+  template<int Backend> void Board::genMoves(MoveList& moves) {
+    moves.clear();                       // Clear the list of possible moves available for this particular board
+    clearCounters();                     // Clear the possible promotions, checks and the safety board
     checkmate = EMPTY;                   // Clear the checkmate-flag for this particular board
 
-    // Safety board clear
-    for (int i = 0; i < 64; i++)
-      safetyBoard[i] = 0;
+    // All pawns at once, then every other piece, straight into the list
+    genPawnPushes(moves, ~(BitBoard)0);
+    genPawnCaptures(moves);
 
-    // Generate move-bit-boards for each piece
-    for (int i = 0; i < 64; i++) {
-      if (curPos.square[i].getColor() == curTurn) {
-	switch (curPos.square[i].getPiece()) {
-	case PAWN:
-	  moveSet = genPawnMoves(i);
-	  allMoves.insert(allMoves.end(), moveSet.begin(), moveSet.end());
-	  moveSet = genPawnCaptures(i);
-	  allMoves.insert(allMoves.end(), moveSet.begin(), moveSet.end());
-	  break;
-	case ROOK:
-	  moveSet = genRookMoves(i);
-	  allMoves.insert(allMoves.end(), moveSet.begin(), moveSet.end());
-	  moveSet = genRookCaptures(i);
-	  allMoves.insert(allMoves.end(), moveSet.begin(), moveSet.end());
-	  break;
-	case KNIGHT:
-	  moveSet = genKnightMoves(i);
-	  allMoves.insert(allMoves.end(), moveSet.begin(), moveSet.end());
-	  moveSet = genKnightCaptures(i);
-	  allMoves.insert(allMoves.end(), moveSet.begin(), moveSet.end());
-	  break;
-	case BISHOP:
-	  moveSet = genBishopMoves(i);
-	  allMoves.insert(allMoves.end(), moveSet.begin(), moveSet.end());
-	  moveSet = genBishopCaptures(i);
-	  allMoves.insert(allMoves.end(), moveSet.begin(), moveSet.end());
-	  break;
-	case QUEEN:
-	  moveSet = genQueenMoves(i);
-	  allMoves.insert(allMoves.end(), moveSet.begin(), moveSet.end());
-	  moveSet = genQueenCaptures(i);
-	  allMoves.insert(allMoves.end(), moveSet.begin(), moveSet.end());
-	  break;
-	case KING:
-	  moveSet = genKingMoves(i);
-	  allMoves.insert(allMoves.end(), moveSet.begin(), moveSet.end());
-	  moveSet = genKingCaptures(i);
-	  allMoves.insert(allMoves.end(), moveSet.begin(), moveSet.end());
-	  moveSet = genCastlingMoves(i);
-	  allMoves.insert(allMoves.end(), moveSet.begin(), moveSet.end());
-	  break;
-	}
+    for (BitBoard own = curPos.colors[curPos.side] & ~curPos.pieces[PAWN]; own; ) {
+      int i = popFirstBit(own);
+
+      switch (curPos.square[i].getPiece()) {
+      case ROOK:
+	genRookMoves<Backend>(i, moves);
+	genRookCaptures<Backend>(i, moves);
+	break;
+      case KNIGHT:
+	genKnightMoves(i, moves);
+	genKnightCaptures(i, moves);
+	break;
+      case BISHOP:
+	genBishopMoves<Backend>(i, moves);
+	genBishopCaptures<Backend>(i, moves);
+	break;
+      case QUEEN:
+	genQueenMoves<Backend>(i, moves);
+	genQueenCaptures<Backend>(i, moves);
+	break;
+      case KING:
+	genKingMoves(i, moves);
+	genKingCaptures(i, moves);
+	genCastlingMoves<Backend>(i, moves);
+	break;
       }
     }
   }
   
   
+  //! Generate all legal moves for the side that is about to make a move into a given move list.
+  /** The pieces pinned to the own king and the squares that get the king out of check are computed once,
+   *  then every pseudo-legal move from genMoves() is kept only if it stays on its pin line, answers a check
+   *  and, for the king, does not walk into an attack. No move has to be made to find out whether it is legal.
+   *  @param moves is cleared and then filled with the legal moves
+   *  @see genMoves()
+   */
+  template<int Backend> void Board::genLegalMoves(MoveList& moves) {
+    BitBoard pinned = pinnedPieces<Backend>(curPos.side);
+    BitBoard evasions = checkMask<Backend>();
+    int legal = 0;
+
+    genMoves<Backend>(moves);
+
+    for (int i = 0; i < moves.size(); i++)
+      if (isLegal<Backend>(moves[i], pinned, evasions))
+	moves[legal++] = moves[i];
+
+    moves.resize(legal);
+  }
+
+
+  //! Generate the captures and promotions of the side to move into a given move list.
+  /** These are the moves worth searching first, and the only ones a capture search needs. Together with
+   *  genQuiets() they make up exactly the moves of genMoves(), so a search that is cut off by a capture
+   *  never has to generate the quiet moves at all.
+   *  @param moves is cleared and then filled with the pseudo-legal captures, en passant captures and promotions
+   *  @see genQuiets()
+   *  @see isLegal()
+   */
+  template<int Backend> void Board::genCaptures(MoveList& moves) {
+    BitBoard own = curPos.colors[curPos.side] & ~curPos.pieces[PAWN];
+
+    moves.clear();
+    genPawnCaptures(moves);
+    genPawnPushes(moves, ROW_SQUARES(curPos.side == WHITE ? 0 : 7));
+
+    while (own) {
+      int i = popFirstBit(own);
+
+      switch (curPos.square[i].getPiece()) {
+      case ROOK:
+	genRookCaptures<Backend>(i, moves);
+	break;
+      case KNIGHT:
+	genKnightCaptures(i, moves);
+	break;
+      case BISHOP:
+	genBishopCaptures<Backend>(i, moves);
+	break;
+      case QUEEN:
+	genQueenCaptures<Backend>(i, moves);
+	break;
+      case KING:
+	genKingCaptures(i, moves);
+	break;
+      }
+    }
+  }
+
+
+  //! Generate the quiet moves of the side to move into a given move list.
+  /** Quiet moves are all moves that neither capture nor promote, castling included.
+   *  @param moves is cleared and then filled with the pseudo-legal quiet moves
+   *  @see genCaptures()
+   *  @see isLegal()
+   */
+  template<int Backend> void Board::genQuiets(MoveList& moves) {
+    BitBoard own = curPos.colors[curPos.side] & ~curPos.pieces[PAWN];
+
+    moves.clear();
+    genPawnPushes(moves, ~ROW_SQUARES(curPos.side == WHITE ? 0 : 7));
+
+    while (own) {
+      int i = popFirstBit(own);
+
+      switch (curPos.square[i].getPiece()) {
+      case ROOK:
+	genRookMoves<Backend>(i, moves);
+	break;
+      case KNIGHT:
+	genKnightMoves(i, moves);
+	break;
+      case BISHOP:
+	genBishopMoves<Backend>(i, moves);
+	break;
+      case QUEEN:
+	genQueenMoves<Backend>(i, moves);
+	break;
+      case KING:
+	genKingMoves(i, moves);
+	genCastlingMoves<Backend>(i, moves);
+	break;
+      }
+    }
+  }
+
+
+  //! Check whether a move, possibly taken from another position, is one genMoves() would generate here.
+  /** Moves from the transposition table or the killer slots are searched before anything is generated,
+   *  so they have to be checked first. Only the moves of the piece on the source square are generated.
+   *  @param aMove is the move in question
+   *  @return true if the piece on the source square belongs to the side to move and can make the move
+   *  @see isLegal()
+   */
+  template<int Backend> bool Board::isPseudoLegal(PackedMove aMove) {
+    int source = aMove.source();
+    MoveList moves;
+
+    if (curPos.square[source].getColor() != curPos.side)
+      return false;
+
+    switch (curPos.square[source].getPiece()) {
+    case PAWN:
+      genPawnMoves(source, moves);
+      genPawnCaptures(source, moves);
+      break;
+    case ROOK:
+      genRookMoves<Backend>(source, moves);
+      genRookCaptures<Backend>(source, moves);
+      break;
+    case KNIGHT:
+      genKnightMoves(source, moves);
+      genKnightCaptures(source, moves);
+      break;
+    case BISHOP:
+      genBishopMoves<Backend>(source, moves);
+      genBishopCaptures<Backend>(source, moves);
+      break;
+    case QUEEN:
+      genQueenMoves<Backend>(source, moves);
+      genQueenCaptures<Backend>(source, moves);
+      break;
+    case KING:
+      genKingMoves(source, moves);
+      genKingCaptures(source, moves);
+      genCastlingMoves<Backend>(source, moves);
+      break;
+    }
+
+    for (int i = 0; i < moves.size(); i++)
+      if (moves[i] == aMove)
+	return true;
+
+    return false;
+  }
+
+
+  //! Check whether a move neither captures nor promotes.
+  /** @param aMove is a move of the side to move
+   *  @return true if aMove is one genQuiets() generates
+   */
+  bool Board::isQuiet(PackedMove aMove) {
+    return aMove.type() != MOVE_PROMOTION && aMove.type() != MOVE_ENPASSANT &&
+      curPos.square[aMove.dest()].getPiece() == EMPTY;
+  }
+
+
+  //! Return all pieces of either color that attack a square.
+  /** Sliders are stopped by the pieces in occ, so pieces can be taken away from occ to look through them,
+   *  as the static exchange evaluation does.
+   *  @param sq is the square in question
+   *  @param occ are the occupied squares
+   *  @return A bit board of all pieces, white and black, that attack sq
+   *  @see isAttacked()
+   */
+  template<int Backend> BitBoard Board::attackersTo(int sq, BitBoard occ) {
+    return (pawnAttacks[WHITE][sq] & curPos.pieceBoard(BLACK, PAWN))
+      | (pawnAttacks[BLACK][sq] & curPos.pieceBoard(WHITE, PAWN))
+      | (knightAttacks[sq] & curPos.pieces[KNIGHT])
+      | (kingAttacks[sq] & curPos.pieces[KING])
+      | (rookAttacks<Backend>(sq, occ) & (curPos.pieces[ROOK] | curPos.pieces[QUEEN]))
+      | (bishopAttacks<Backend>(sq, occ) & (curPos.pieces[BISHOP] | curPos.pieces[QUEEN]));
+  }
+
+
+  // The public members that look up slider attacks, each running the instance of its member template for the
+  // backend chosen at start up. The PEXT instance is run by a member of the same name ending in Pext, which is
+  // compiled for BMI2 with everything below inlined, so the backend is tested once per call and not per lookup.
+#ifdef HAVE_PEXT
+#define BACKEND_ENTRY(type, name, params, args)				\
+  type Board::name params {						\
+    return attackBackend == ATTACKS_PEXT ? name##Pext args : name<ATTACKS_MAGIC> args; \
+  }									\
+  type Board::name##Pext params {					\
+    return name<ATTACKS_PEXT> args;					\
+  }
+#else
+#define BACKEND_ENTRY(type, name, params, args)				\
+  type Board::name params {						\
+    return name<ATTACKS_MAGIC> args;					\
+  }
+#endif
+
+  BACKEND_ENTRY(BitBoard, attackersTo, (int sq, BitBoard occ), (sq, occ))
+  BACKEND_ENTRY(bool, isAttacked, (int sq, int color), (sq, color))
+  BACKEND_ENTRY(double, see, (PackedMove aMove), (aMove))
+  BACKEND_ENTRY(BitBoard, pinnedPieces, (int color), (color))
+  BACKEND_ENTRY(BitBoard, checkMask, (void), ())
+  BACKEND_ENTRY(bool, isLegal, (PackedMove aMove, BitBoard pinned, BitBoard evasions), (aMove, pinned, evasions))
+  BACKEND_ENTRY(bool, isPseudoLegal, (PackedMove aMove), (aMove))
+  BACKEND_ENTRY(void, genMoves, (MoveList& moves), (moves))
+  BACKEND_ENTRY(void, genLegalMoves, (MoveList& moves), (moves))
+  BACKEND_ENTRY(void, genCaptures, (MoveList& moves), (moves))
+  BACKEND_ENTRY(void, genQuiets, (MoveList& moves), (moves))
+  BACKEND_ENTRY(void, genRookMoves, (int sq, MoveList& moves), (sq, moves))
+  BACKEND_ENTRY(void, genRookCaptures, (int sq, MoveList& captures), (sq, captures))
+  BACKEND_ENTRY(void, genBishopMoves, (int sq, MoveList& moves), (sq, moves))
+  BACKEND_ENTRY(void, genBishopCaptures, (int sq, MoveList& captures), (sq, captures))
+  BACKEND_ENTRY(void, genQueenMoves, (int sq, MoveList& moves), (sq, moves))
+  BACKEND_ENTRY(void, genQueenCaptures, (int sq, MoveList& captures), (sq, captures))
+  BACKEND_ENTRY(void, genCastlingMoves, (int sq, MoveList& castlings), (sq, castlings))
+
+
+  //! Return all pieces of either color that attack a square on the current board.
+  BitBoard Board::attackersTo(int sq) {
+    return attackersTo(sq, curPos.occupied());
+  }
+
+
+  //! Check whether a square is attacked by any piece of a given color.
+  /** @param sq is the square in question
+   *  @param color is the attacking side, WHITE or BLACK
+   *  @return true if at least one piece of that color attacks sq
+   */
+  template<int Backend> bool Board::isAttacked(int sq, int color) {
+    return (attackersTo<Backend>(sq, curPos.occupied()) & curPos.colors[color]) != 0;
+  }
+
+
+  //! Check whether the king of the side to move is in check.
+  bool Board::isInCheck(void) {
+    return isAttacked(firstBit(curPos.pieceBoard(curPos.side, KING)), curPos.side == WHITE ? BLACK : WHITE);
+  }
+
+
+  //! Static exchange evaluation of a move.
+  /** All captures on the destination square of the move are played out, each side always taking back with its least
+   *  valuable attacker and stopping whenever that would lose material. Pieces behind the capturing ones join in
+   *  as soon as their line is free.
+   *  @param aMove is the move to evaluate, usually a capture
+   *  @return The material the side to move wins (or loses, if negative) by the exchange
+   *  @see getPieceValue()
+   */
+  template<int Backend> double Board::see(PackedMove aMove) {
+    int source = aMove.source(), dest = aMove.dest();
+    int side = curPos.square[source].getColor(), piece = curPos.square[source].getPiece();
+    BitBoard occupied = curPos.occupied(), attackers, from = squareMask[source];
+    double gain[32];
+    int d = 0;
+
+    if (aMove.type() == MOVE_ENPASSANT) {
+      gain[0] = getPieceValue(PAWN);
+      occupied ^= squareMask[side == WHITE ? dest + 8 : dest - 8];
+    }
+    else
+      gain[0] = curPos.square[dest].getPiece() == EMPTY ? 0 : getPieceValue(curPos.square[dest].getPiece());
+
+    do {
+      d++;
+      side = side == WHITE ? BLACK : WHITE;
+
+      // What the side that has just captured has won, if the piece is taken back
+      gain[d] = getPieceValue(piece) - gain[d - 1];
+      if ((-gain[d - 1] > gain[d] ? -gain[d - 1] : gain[d]) < 0)
+	break;
+
+      occupied ^= from;
+      attackers = attackersTo<Backend>(dest, occupied) & occupied & curPos.colors[side];
+
+      // Next capture with the least valuable attacker
+      for (from = 0, piece = PAWN; piece <= KING; piece++) {
+	if (attackers & curPos.pieces[piece]) {
+	  from = squareMask[firstBit(attackers & curPos.pieces[piece])];
+	  break;
+	}
+      }
+    } while (from);
+
+    while (--d)
+      gain[d - 1] = -(-gain[d - 1] > gain[d] ? -gain[d - 1] : gain[d]);
+
+    return gain[0];
+  }
+
+
+  //! Return the pieces of the given color that cannot leave the line between their king and an opponent slider.
+  template<int Backend> BitBoard Board::pinnedPieces(int color) {
+    int king = firstBit(curPos.pieceBoard(color, KING));
+    BitBoard occupied = curPos.occupied(), pinned = 0, snipers;
+
+    snipers = ((rookAttacks<Backend>(king, 0) & (curPos.pieces[ROOK] | curPos.pieces[QUEEN]))
+	       | (bishopAttacks<Backend>(king, 0) & (curPos.pieces[BISHOP] | curPos.pieces[QUEEN])))
+      & curPos.colors[color == WHITE ? BLACK : WHITE];
+
+    for (; snipers; snipers &= snipers - 1) {
+      BitBoard between = betweenSquares[king][firstBit(snipers)] & occupied;
+
+      // Exactly one piece in between, and it is one of ours
+      if (between && !(between & (between - 1)) && (between & curPos.colors[color]))
+	pinned |= between;
+    }
+
+    return pinned;
+  }
+
+
+  //! Return the squares a piece other than the king may move to while the side to move is in check.
+  /** @return all squares if the king is not in check, the checking piece and the squares between it and the king
+   *  if there is one, nothing in a double check
+   */
+  template<int Backend> BitBoard Board::checkMask(void) {
+    int king = firstBit(curPos.pieceBoard(curPos.side, KING));
+    BitBoard checkers = attackersTo<Backend>(king, curPos.occupied())
+      & curPos.colors[curPos.side == WHITE ? BLACK : WHITE];
+
+    if (!checkers)
+      return ~(BitBoard)0;
+    else if (checkers & (checkers - 1))
+      return 0;
+
+    return checkers | betweenSquares[king][firstBit(checkers)];
+  }
+
+
+  //! Check whether a pseudo-legal move of the side to move leaves its own king safe.
+  /** @param aMove is a move from genMoves()
+   *  @param pinned are the pinned pieces of the side to move, see pinnedPieces()
+   *  @param evasions are the squares that answer a check, see checkMask()
+   *  @return true if the move is legal
+   */
+  template<int Backend> bool Board::isLegal(PackedMove aMove, BitBoard pinned, BitBoard evasions) {
+    int source = aMove.source(), dest = aMove.dest();
+    int them = curPos.side == WHITE ? BLACK : WHITE;
+    int king = firstBit(curPos.pieceBoard(curPos.side, KING));
+    BitBoard occupied = curPos.occupied();
+
+    if (source == king) {
+      // genCastlingMoves() has already made sure the king does not castle out of, through or into check
+      if (aMove.type() == MOVE_CASTLING)
+	return true;
+
+      // The king must not stay on a line it is attacked along, so it is taken off the board for this test
+      return !(attackersTo<Backend>(dest, occupied ^ squareMask[king]) & curPos.colors[them]);
+    }
+
+    if (aMove.type() == MOVE_ENPASSANT) {
+      int captured = curPos.side == WHITE ? dest + 8 : dest - 8;
+      BitBoard after = (occupied ^ squareMask[source] ^ squareMask[captured]) | squareMask[dest];
+
+      // Two pawns leave the row at once, so look for sliders on the king from scratch
+      return (evasions & (squareMask[dest] | squareMask[captured]))
+	&& !(rookAttacks<Backend>(king, after) & (curPos.pieces[ROOK] | curPos.pieces[QUEEN]) & curPos.colors[them])
+	&& !(bishopAttacks<Backend>(king, after) & (curPos.pieces[BISHOP] | curPos.pieces[QUEEN]) & curPos.colors[them]);
+    }
+
+    if (!(evasions & squareMask[dest]))
+      return false;
+
+    return !(pinned & squareMask[source]) || (lineSquares[king][source] & squareMask[dest]);
+  }
+
+
+  //! Shift a bit board by offset squares, towards a8 if offset is negative, towards h1 otherwise.
+  static inline BitBoard shiftSquares(BitBoard b, int offset) {
+    return offset > 0 ? b << offset : b >> -offset;
+  }
+
+
+  //! Return the squares the pawns of a color can move one row forward to.
+  /** @param color is WHITE or BLACK
+   *  @return the empty squares right in front of a pawn of that color
+   */
+  BitBoard Board::pawnPushes(int color) {
+    return shiftSquares(curPos.pieceBoard(color, PAWN), color == WHITE ? -8 : 8) & ~curPos.occupied();
+  }
+
+
+  //! Return the squares the pawns of a color attack towards the a-column.
+  BitBoard Board::pawnAttacksWest(int color) {
+    return shiftSquares(curPos.pieceBoard(color, PAWN) & ~COL_A_SQUARES, color == WHITE ? -9 : 7);
+  }
+
+
+  //! Return the squares the pawns of a color attack towards the h-column.
+  BitBoard Board::pawnAttacksEast(int color) {
+    return shiftSquares(curPos.pieceBoard(color, PAWN) & ~COL_H_SQUARES, color == WHITE ? -7 : 9);
+  }
+
+
+  //! Return all squares attacked by at least one pawn of a color, whether they are occupied or not.
+  /** @param color is WHITE or BLACK
+   *  @see pawnAttacksWest()
+   *  @see pawnAttacksEast()
+   */
+  BitBoard Board::pawnAttackSpan(int color) {
+    return pawnAttacksWest(color) | pawnAttacksEast(color);
+  }
+
+
+  //! Return the number of pawns of a color that can promote by moving one row forward.
+  int Board::pawnPromotions(int color) {
+    return popCount(pawnPushes(color) & ROW_SQUARES(color == WHITE ? 0 : 7));
+  }
+
+
+  //! Generate the single and double pushes of all pawns of the side to move at once.
+  /** The whole pawn bit board is shifted one row forward onto the empty squares, and those pawns that have
+   *  landed on the third row are shifted once more. Pushes onto the last row become promotions and are
+   *  counted as such.
+   *  @param moves is the list the pawn moves are appended to
+   *  @param targets limits the destination squares, e.g. to the last row for promotions only
+   *  @see getPromotions()
+   */
+  void Board::genPawnPushes(MoveList& moves, BitBoard targets) {
+    int offset = curPos.side == WHITE ? -8 : 8;
+    BitBoard single = pawnPushes(curPos.side);
+    BitBoard twice = shiftSquares(single & ROW_SQUARES(curPos.side == WHITE ? 5 : 2), offset) & ~curPos.occupied();
+
+    promotions += popCount(single & targets & ROW_SQUARES(curPos.side == WHITE ? 0 : 7));
+
+    addPawnMoves(moves, single & targets, offset);
+    addPawnMoves(moves, twice & targets, 2 * offset);
+  }
+
+
+  //! Generate the captures of all pawns of the side to move at once.
+  /** Captures towards either column are found by shifting the whole pawn bit board diagonally. Checks,
+   *  promotions and piece safety are counted just like genPawnCaptures(int, MoveList&) does it pawn by pawn.
+   *  @param captures is the list the pawn captures, including en passant, are appended to
+   *  @see getSafetyBoard()
+   *  @see getChecks()
+   */
+  void Board::genPawnCaptures(MoveList& captures) {
+    int color = curPos.side, them = color == WHITE ? BLACK : WHITE;
+    int westOffset = color == WHITE ? -9 : 7, eastOffset = color == WHITE ? -7 : 9;
+    BitBoard west = pawnAttacksWest(color), east = pawnAttacksEast(color);
+    BitBoard king = curPos.pieceBoard(them, KING), targets;
+
+    checks += ((west & king) != 0) + ((east & king) != 0);
+
+    // Pawns on the row before the last that can capture to both sides
+    promotions += popCount(shiftSquares(west & curPos.colors[them], -westOffset)
+			   & shiftSquares(east & curPos.colors[them], -eastOffset)
+			   & ROW_SQUARES(color == WHITE ? 1 : 6));
+
+    addPawnMoves(captures, west & curPos.colors[them], westOffset);
+    addPawnMoves(captures, east & curPos.colors[them], eastOffset);
+
+    // En passant, the square passed by a pawn that has just moved two rows forward
+    if (curPos.epSquare != NO_SQUARE)
+      for (targets = pawnAttacks[them][curPos.epSquare] & curPos.pieceBoard(color, PAWN); targets; )
+	captures.push_back(PackedMove(popFirstBit(targets), curPos.epSquare, MOVE_ENPASSANT));
+
+    // Piece safety
+    for (targets = west & curPos.colors[color]; targets; )
+      safetyBoard[popFirstBit(targets)] += 100;
+    for (targets = east & curPos.colors[color]; targets; )
+      safetyBoard[popFirstBit(targets)] += 100;
+  }
+
+
   /** This method generates a list of possible moves for a pawn on location pawnLocation.
    *  It automatically determines the pawn's colour and takes care that the pawns move in the right
    *  direction only.
    *  @param pawnLocation an integer that represents the current pawn location on a bit board
-   *  @return a vector containing the list of possible pawn moves
+   *  @param moves is the list the possible pawn moves are appended to
    */
-  vector<BitBoardMove> Board::genPawnMoves(int pawnLocation) {
-    vector<BitBoardMove> moves;
+  void Board::genPawnMoves(int pawnLocation, MoveList& moves) {
     int offset = 0, doubleOffset = 0;
-    BitBoardMove myMove;
-    myMove.source = mask[pawnLocation];
     
     if (curPos.square[pawnLocation].getColor() == WHITE) {
       offset = -8;
@@ -233,16 +664,12 @@ namespace brd {
     }
 
     // Check if the pawn on pawnLocation can move one row forward
-    if ( possiblePawnMove(pawnLocation, offset) ) {
-      myMove.dest = mask[pawnLocation + offset];
-      moves.push_back(myMove);
-    }
+    if ( possiblePawnMove(pawnLocation, offset) )
+      addPawnMove(moves, pawnLocation, pawnLocation + offset);
     
     // Check if the pawn on pawnLocation can move two rows forward
-    if ( possiblePawnMove(pawnLocation, doubleOffset) ) {
-      myMove.dest = mask[pawnLocation + doubleOffset];
-      moves.push_back(myMove);
-    }
+    if ( possiblePawnMove(pawnLocation, doubleOffset) )
+      moves.push_back(PackedMove(pawnLocation, pawnLocation + doubleOffset));
     
     // Check promotions
     if ( (possiblePawnMove(pawnLocation, offset)) &&
@@ -250,8 +677,6 @@ namespace brd {
 	   (curPos.square[pawnLocation].getColor() == BLACK && ROW(pawnLocation) == 6) ) ) {
       promotions++;
     }
-
-    return moves;
   }
 
 
@@ -263,53 +688,43 @@ namespace brd {
    * @see getSafetyBoard()
    * @see getChecks()
    * @param pawnLocation an integer that represents the current pawn location on a bit board
-   * @return a vector containing the list of possible pawn captures
+   * @param captures is the list the possible pawn captures are appended to
    */
-  vector<BitBoardMove> Board::genPawnCaptures(int pawnLocation) {
-    int capLeft = 0, capRight = 0;
-    vector<BitBoardMove> captures;
-    BitBoardMove myMove;
-    BitBoard *myPieces;
-    myMove.source = mask[pawnLocation];
+  void Board::genPawnCaptures(int pawnLocation, MoveList& captures) {
+    BitBoard *myPieces, oponents, attacks, targets;
+    int color = curPos.square[pawnLocation].getColor(), found = 0;
+    attacks = pawnAttacks[color][pawnLocation];
 
-    if (curPos.square[pawnLocation].getColor() == WHITE) {
-      capLeft = -9;
-      capRight = -7;
-      myPieces = &curPos.whitePieces;
+    if (color == WHITE) {
+      myPieces = &curPos.colors[WHITE];
+      oponents = curPos.colors[BLACK];
     }
     else {
-      capLeft = 7;
-      capRight = 9;
-      myPieces = &curPos.blackPieces;
-    }
-      
-    if (possiblePawnCapture(pawnLocation, capLeft)) {
-      myMove.dest = mask[pawnLocation+capLeft];
-      if (curPos.square[pawnLocation+capLeft].getPiece() == KING) checks++;
-      captures.push_back(myMove);
+      myPieces = &curPos.colors[BLACK];
+      oponents = curPos.colors[WHITE];
     }
-    if (possiblePawnCapture(pawnLocation, capRight)) {
-      myMove.dest = mask[pawnLocation+capRight];
-      if (curPos.square[pawnLocation+capRight].getPiece() == KING) checks++;
-      captures.push_back(myMove);
+
+    for (targets = attacks & oponents; targets; targets &= targets - 1) {
+      int dest = firstBit(targets);
+      if (curPos.square[dest].getPiece() == KING) checks++;
+      addPawnMove(captures, pawnLocation, dest);
+      found++;
     }
 
     // Check promotions
-    if ( ( (possiblePawnCapture(pawnLocation, capLeft)) && (possiblePawnCapture(pawnLocation, capRight)) ) &&
-	 ( (curPos.square[pawnLocation].getColor() == WHITE && ROW(pawnLocation) == 1) ||
-	   (curPos.square[pawnLocation].getColor() == BLACK && ROW(pawnLocation) == 6) ) ) {
+    if ( found == 2 &&
+	 ( (color == WHITE && ROW(pawnLocation) == 1) ||
+	   (color == BLACK && ROW(pawnLocation) == 6) ) ) {
       promotions++;
     }
 
-    // Piece safety
-    if ( COL(pawnLocation) > 0 && (pawnLocation+capLeft >= 0 && pawnLocation <= 63) && (mask[pawnLocation+capLeft] & *myPieces) ) {
-      safetyBoard[pawnLocation+capLeft] += 100;
-    }
-    if ( COL(pawnLocation) < 7 && (pawnLocation+capRight >= 0 && pawnLocation <=63) && (mask[pawnLocation+capRight] & *myPieces) ) {
-      safetyBoard[pawnLocation+capRight] += 100;
-    }
+    // En passant, the square passed by a pawn that has just moved two rows forward
+    if (curPos.epSquare != NO_SQUARE && (attacks & squareMask[curPos.epSquare]))
+      captures.push_back(PackedMove(pawnLocation, curPos.epSquare, MOVE_ENPASSANT));
 
-    return captures;
+    // Piece safety
+    for (targets = attacks & *myPieces; targets; targets &= targets - 1)
+      safetyBoard[firstBit(targets)] += 100;
   }
 
 
@@ -319,178 +734,29 @@ namespace brd {
    *  @see getSafetyBoard()
    *  @see getChecks()
    *  @param rookLocation an integer that represents the current rook location on a bit board
-   *  @return a vector containing the list of possible rook captures
+   *  @param captures is the list the possible rook captures are appended to
    */
-  vector<BitBoardMove> Board::genRookCaptures(int rookLocation) {
-    vector<BitBoardMove> captures;
-    BitBoard *myPieces, oponents = 0;
-    BitBoardMove myMove;
-    myMove.source = mask[rookLocation];
-    
-    if (curTurn == WHITE) {
-      myPieces = &curPos.whitePieces;
-      oponents = curPos.blackPieces;
-    }
-    else {
-      myPieces = &curPos.blackPieces;
-      oponents = curPos.whitePieces;
-    }
-
-    for (int u = 0; u < 7; u++) {
-      if ( !outOfBoundary(rookLocation, rookPosLeft[u]) ) {
-	if ( mask[rookLocation+rookPosLeft[u]] & (mask[rookLocation+rookPosLeft[u]] & *myPieces) ) {
-	  safetyBoard[rookLocation+rookPosLeft[u]] += 1;
-	  break;
-	}
-	else if ( mask[rookLocation+rookPosLeft[u]] & (mask[rookLocation+rookPosLeft[u]] & oponents) ) {
-	  myMove.dest = mask[rookLocation+rookPosLeft[u]];
-
-	  if (curPos.square[rookLocation+rookPosLeft[u]].getPiece() == KING)
-	    checks++;
-
-	  captures.push_back(myMove);
-	  break;
-	}
-      }
-    }
-    for (int u = 0; u < 7; u++) {
-      if ( !outOfBoundary(rookLocation, rookPosRight[u]) ) {
-	if ( mask[rookLocation+rookPosRight[u]] & (mask[rookLocation+rookPosRight[u]] & *myPieces) ) {
-	  safetyBoard[rookLocation+rookPosRight[u]] += 1;
-	  break;
-	}
-	else if ( mask[rookLocation+rookPosRight[u]] & (mask[rookLocation+rookPosRight[u]] & oponents) ) {
-	  myMove.dest = mask[rookLocation+rookPosRight[u]];
-
-	  if (curPos.square[rookLocation+rookPosRight[u]].getPiece() == KING)
-	    checks++;
-
-	  captures.push_back(myMove);
-	  break;
-	}
-      }
-    }
-    for (int u = 0; u < 7; u++) {
-      if ( rookLocation + rookPosUp[u] < 64 && rookLocation + rookPosUp[u] >= 0 ) {
-	if ( mask[rookLocation+rookPosUp[u]] & (mask[rookLocation+rookPosUp[u]] & *myPieces) ) {
-	  safetyBoard[rookLocation+rookPosUp[u]] += 1;
-	  break;
-	}
-	else if ( mask[rookLocation+rookPosUp[u]] & (mask[rookLocation+rookPosUp[u]] & oponents) ) {
-	  myMove.dest = mask[rookLocation+rookPosUp[u]];
-
-	  if (curPos.square[rookLocation+rookPosUp[u]].getPiece() == KING)
-	    checks++;
-
-	  captures.push_back(myMove);
-	  break;
-	}
-      }
-    }
-    for (int u = 0; u < 7; u++) {
-      if ( rookLocation + rookPosDown[u] < 64 && rookLocation + rookPosDown[u] >= 0 ) {
-	if ( mask[rookLocation+rookPosDown[u]] & (mask[rookLocation+rookPosDown[u]] & *myPieces) ) {
-	  safetyBoard[rookLocation+rookPosDown[u]] += 1;
-	  break;
-	}
-	else if ( mask[rookLocation+rookPosDown[u]] & (mask[rookLocation+rookPosDown[u]] & oponents) ) {
-	  myMove.dest = mask[rookLocation+rookPosDown[u]];
-
-	  if (curPos.square[rookLocation+rookPosDown[u]].getPiece() == KING)
-	    checks++;
-
-	  captures.push_back(myMove);
-	  break;
-	}
-      }
-    }
-    
-    return captures;
+  template<int Backend> void Board::genRookCaptures(int rookLocation, MoveList& captures) {
+    addCaptures(captures, rookLocation, rookAttacks<Backend>(rookLocation, curPos.colors[WHITE]|curPos.colors[BLACK]));
   }
 
 
   /** This method generates a list of possible moves for a rook on location rookLocation.
    *  @param rookLocation an integer that represents the current rook location on a bit board
-   *  @return a vector containing the list of possible rook moves
+   *  @param moves is the list the possible rook moves are appended to
    */
-  vector<BitBoardMove> Board::genRookMoves(int rookLocation) {
-    vector<BitBoardMove> moves;
-    BitBoardMove myMove;
-    myMove.source = mask[rookLocation];
-
-    for (int u = 0; u < 7; u++) {
-      if ( !outOfBoundary(rookLocation, rookPosLeft[u]) ) {
-	if ( mask[rookLocation+rookPosLeft[u]] & (mask[rookLocation+rookPosLeft[u]] & (curPos.whitePieces|curPos.blackPieces)) )
-	  break;
-	else {
-	  myMove.dest = mask[rookLocation+rookPosLeft[u]] & ~(curPos.whitePieces|curPos.blackPieces);
-	  moves.push_back(myMove);
-	}
-      }
-    }
-    for (int u = 0; u < 7; u++) {
-      if ( !outOfBoundary(rookLocation, rookPosRight[u]) ) {
-	if ( mask[rookLocation+rookPosRight[u]] & (mask[rookLocation+rookPosRight[u]] & (curPos.whitePieces|curPos.blackPieces)) )
-	  break;
-	else {
-	  myMove.dest = mask[rookLocation+rookPosRight[u]] & ~(curPos.whitePieces|curPos.blackPieces);
-	  moves.push_back(myMove);
-	}
-      }
-    }
-    for (int u = 0; u < 7; u++) {
-      if ( rookLocation + rookPosUp[u] < 64 && rookLocation + rookPosUp[u] >= 0 ) {
-	if ( mask[rookLocation+rookPosUp[u]] & (mask[rookLocation+rookPosUp[u]] & (curPos.whitePieces|curPos.blackPieces)) )
-	  break;
-	else {
-	  myMove.dest = mask[rookLocation+rookPosUp[u]] & ~(curPos.whitePieces|curPos.blackPieces);
-	  moves.push_back(myMove);
-	}
-      }
-    }
-    for (int u = 0; u < 7; u++) {
-      if ( rookLocation + rookPosDown[u] < 64 && rookLocation + rookPosDown[u] >= 0 ) {
-	if ( mask[rookLocation+rookPosDown[u]] & (mask[rookLocation+rookPosDown[u]] & (curPos.whitePieces|curPos.blackPieces)) )
-	  break;
-	else {
-	  myMove.dest = mask[rookLocation+rookPosDown[u]] & ~(curPos.whitePieces|curPos.blackPieces);
-	  moves.push_back(myMove);
-	}
-      }
-    }
-    
-    return moves;
+  template<int Backend> void Board::genRookMoves(int rookLocation, MoveList& moves) {
+    BitBoard occupied = curPos.colors[WHITE]|curPos.colors[BLACK];
+    addMoves(moves, rookLocation, rookAttacks<Backend>(rookLocation, occupied) & ~occupied);
   }
 
 
   /** This method generates a list of possible moves for a knight on location knightLocation.
    *  @param knightLocation an integer that represents the current knight location on a bit board
-   *  @return a vector containing the list of possible knight moves
-   */
-  vector<BitBoardMove> Board::genKnightMoves(int knightLocation) {
-    vector<BitBoardMove> moves;
-    BitBoardMove myMove;
-    myMove.source = mask[knightLocation];
-
-    for (int u = 0; u < 8; u++) {
-      if ( knightLocation + knightPos[u] < 64 && knightLocation + knightPos[u] >= 0 ) {
-	if (mask[knightLocation+knightPos[u]] & ~(curPos.whitePieces|curPos.blackPieces)) {
-	  if (!( (ROW(knightLocation) < 2 || COL(knightLocation) < 1) && knightPos[u] == -17 ) &&
-	      !( (ROW(knightLocation) > 5 || COL(knightLocation) > 6) && knightPos[u] ==  17 ) &&
-	      !( (ROW(knightLocation) < 2 || COL(knightLocation) > 6) && knightPos[u] == -15 ) &&
-	      !( (ROW(knightLocation) > 5 || COL(knightLocation) < 1) && knightPos[u] ==  15 ) &&
-	      !( (ROW(knightLocation) < 1 || COL(knightLocation) > 5) && knightPos[u] ==  -6 ) &&
-	      !( (ROW(knightLocation) > 6 || COL(knightLocation) < 2) && knightPos[u] ==   6 ) &&
-	      !( (ROW(knightLocation) > 6 || COL(knightLocation) > 5) && knightPos[u] ==  10 ) &&
-	      !( (ROW(knightLocation) < 1 || COL(knightLocation) < 2) && knightPos[u] == -10 ) ) {
-	    myMove.dest = mask[knightLocation+knightPos[u]];
-	    moves.push_back(myMove);
-	  }
-	}
-      }
-    }
-
-    return moves;
+   *  @param moves is the list the possible knight moves are appended to
+   */
+  void Board::genKnightMoves(int knightLocation, MoveList& moves) {
+    addMoves(moves, knightLocation, knightAttacks[knightLocation] & ~(curPos.colors[WHITE]|curPos.colors[BLACK]));
   }
 
 
@@ -500,112 +766,20 @@ namespace brd {
    *  @see getSafetyBoard()
    *  @see getChecks()
    *  @param knightLocation an integer that represents the current knight location on a bit board
-   *  @return a vector containing the list of possible knight captures
-   */
-  vector<BitBoardMove> Board::genKnightCaptures(int knightLocation) {
-    vector<BitBoardMove> captures;
-    BitBoardMove myMove;
-    BitBoard oponents = 0;
-    BitBoard *myPieces;
-    myMove.source = mask[knightLocation];
-
-    if (curTurn == WHITE) {
-      oponents = curPos.blackPieces;
-      myPieces = &curPos.whitePieces;
-    } 
-    else {
-      oponents = curPos.whitePieces;
-      myPieces = &curPos.blackPieces;
-    }
-
-    for (int u = 0; u < 8; u++) {
-      if ( knightLocation + knightPos[u] < 64 && knightLocation + knightPos[u] >= 0 ) {
-	if (mask[knightLocation+knightPos[u]] & oponents) {
-	  if (!( (ROW(knightLocation) < 2 || COL(knightLocation) < 1) && knightPos[u] == -17 ) &&
-	      !( (ROW(knightLocation) > 5 || COL(knightLocation) > 6) && knightPos[u] ==  17 ) &&
-	      !( (ROW(knightLocation) < 2 || COL(knightLocation) > 6) && knightPos[u] == -15 ) &&
-	      !( (ROW(knightLocation) > 5 || COL(knightLocation) < 1) && knightPos[u] ==  15 ) &&
-	      !( (ROW(knightLocation) < 1 || COL(knightLocation) > 5) && knightPos[u] ==  -6 ) &&
-	      !( (ROW(knightLocation) > 6 || COL(knightLocation) < 2) && knightPos[u] ==   6 ) &&
-	      !( (ROW(knightLocation) > 6 || COL(knightLocation) > 5) && knightPos[u] ==  10 ) &&
-	      !( (ROW(knightLocation) < 1 || COL(knightLocation) < 2) && knightPos[u] == -10 ) ) {
-	    myMove.dest = mask[knightLocation+knightPos[u]];
-
-	    if (curPos.square[knightLocation+knightPos[u]].getPiece() == KING)
-	      checks++;
-
-	    captures.push_back(myMove);
-	  }
-	}
-	else if (mask[knightLocation+knightPos[u]] & *myPieces) {
-	  if (!( (ROW(knightLocation) < 2 || COL(knightLocation) < 1) && knightPos[u] == -17 ) &&
-	      !( (ROW(knightLocation) > 5 || COL(knightLocation) > 6) && knightPos[u] ==  17 ) &&
-	      !( (ROW(knightLocation) < 2 || COL(knightLocation) > 6) && knightPos[u] == -15 ) &&
-	      !( (ROW(knightLocation) > 5 || COL(knightLocation) < 1) && knightPos[u] ==  15 ) &&
-	      !( (ROW(knightLocation) < 1 || COL(knightLocation) > 5) && knightPos[u] ==  -6 ) &&
-	      !( (ROW(knightLocation) > 6 || COL(knightLocation) < 2) && knightPos[u] ==   6 ) &&
-	      !( (ROW(knightLocation) > 6 || COL(knightLocation) > 5) && knightPos[u] ==  10 ) &&
-	      !( (ROW(knightLocation) < 1 || COL(knightLocation) < 2) && knightPos[u] == -10 ) )
-	    safetyBoard[knightLocation+knightPos[u]] += 1;
-	}
-      }
-    }
-    
-    return captures;
+   *  @param captures is the list the possible knight captures are appended to
+   */
+  void Board::genKnightCaptures(int knightLocation, MoveList& captures) {
+    addCaptures(captures, knightLocation, knightAttacks[knightLocation]);
   }
 
   
   /** This method generates a list of possible moves for a bishop on location bishopLocation.
    *  @param bishopLocation an integer that represents the current bishop location on a bit board
-   *  @return a vector containing the list of possible bishop moves
+   *  @param moves is the list the possible bishop moves are appended to
    */
-  vector<BitBoardMove> Board::genBishopMoves(int bishopLocation) {
-    vector<BitBoardMove> moves;
-    BitBoardMove myMove;
-    myMove.source = mask[bishopLocation];
-
-    for (int u = 0; u < COL(bishopLocation); u++) {
-      if ( bishopLocation + bishPosLUp[u] < 64 && bishopLocation + bishPosLUp[u] >= 0 ) {
-	if ( mask[bishopLocation+bishPosLUp[u]] & (mask[bishopLocation+bishPosLUp[u]] & (curPos.whitePieces|curPos.blackPieces)) )
-	  break;
-	else {
-	  myMove.dest = mask[bishopLocation+bishPosLUp[u]] & ~(curPos.whitePieces|curPos.blackPieces);
-	  moves.push_back(myMove);
-	}
-      }
-    }
-    for (int u = 0; u < COL(bishopLocation); u++) {
-      if ( bishopLocation + bishPosLDown[u] < 64 && bishopLocation + bishPosLDown[u] >= 0 && (COL(bishopLocation) != 0) ) {
-	if ( mask[bishopLocation+bishPosLDown[u]] & (mask[bishopLocation+bishPosLDown[u]] & (curPos.whitePieces|curPos.blackPieces)) )
-	  break;
-	else {
-	  myMove.dest = mask[bishopLocation+bishPosLDown[u]] & ~(curPos.whitePieces|curPos.blackPieces);
-	  moves.push_back(myMove);
-	}
-      }
-    }
-    for (int u = 0; u < 7 - COL(bishopLocation); u++) {
-      if ( bishopLocation + bishPosRUp[u] < 64 && bishopLocation + bishPosRUp[u] >= 0 ) {
-	if ( mask[bishopLocation+bishPosRUp[u]] & (mask[bishopLocation+bishPosRUp[u]] & (curPos.whitePieces|curPos.blackPieces)) )
-	  break;
-	else {
-	  myMove.dest = mask[bishopLocation+bishPosRUp[u]] & ~(curPos.whitePieces|curPos.blackPieces);
-	  moves.push_back(myMove);
-	}
-      }
-    }
-    for (int u = 0; u < 7 - COL(bishopLocation); u++) {
-      if ( bishopLocation + bishPosRDown[u] < 64 && bishopLocation + bishPosRDown[u] >= 0 ) {
-	if ( mask[bishopLocation+bishPosRDown[u]] & (mask[bishopLocation+bishPosRDown[u]] & (curPos.whitePieces|curPos.blackPieces)) )
-	  break;
-	else {
-	  myMove.dest = mask[bishopLocation+bishPosRDown[u]] & ~(curPos.whitePieces|curPos.blackPieces);
-	  moves.push_back(myMove);
-	}
-      }
-    }
-
-    return moves;
+  template<int Backend> void Board::genBishopMoves(int bishopLocation, MoveList& moves) {
+    BitBoard occupied = curPos.colors[WHITE]|curPos.colors[BLACK];
+    addMoves(moves, bishopLocation, bishopAttacks<Backend>(bishopLocation, occupied) & ~occupied);
   }
 
   
@@ -615,109 +789,20 @@ namespace brd {
     *  @see getSafetyBoard()
     *  @see getChecks()
     *  @param bishopLocation an integer that represents the current bishop location on a bit board
-    *  @return a vector containing the list of possible bishop captures
+    *  @param captures is the list the possible bishop captures are appended to
     */
-  vector<BitBoardMove> Board::genBishopCaptures(int bishopLocation) {
-    vector<BitBoardMove> captures;
-    BitBoardMove myMove;
-    BitBoard *myPieces, oponents = 0;
-    myMove.source = mask[bishopLocation];
-
-    if (curTurn == WHITE) {
-      myPieces = &curPos.whitePieces;
-      oponents = curPos.blackPieces;
-    }
-    else {
-      myPieces = &curPos.blackPieces;
-      oponents = curPos.whitePieces;
-    }
-
-    for (int u = 0; u < COL(bishopLocation); u++) {
-      if ( bishopLocation + bishPosLUp[u] < 64 && bishopLocation + bishPosLUp[u] >= 0 ) {
-	if ( mask[bishopLocation+bishPosLUp[u]] & (mask[bishopLocation+bishPosLUp[u]] & *myPieces) ) {
-	  safetyBoard[bishopLocation+bishPosLUp[u]] += 1;
-	  break;
-	}
-	else if ( mask[bishopLocation+bishPosLUp[u]] & (mask[bishopLocation+bishPosLUp[u]] & oponents) ) {
-	  myMove.dest = mask[bishopLocation+bishPosLUp[u]];
-
-	  if (curPos.square[bishopLocation+bishPosLUp[u]].getPiece() == KING)
-	    checks++;
-
-	  captures.push_back(myMove);
-	  break;
-	}
-      }
-    }
-    for (int u = 0; u < COL(bishopLocation); u++) {
-      if ( (bishopLocation + bishPosLDown[u]) < 64 && (bishopLocation + bishPosLDown[u]) >= 0 ) {
-	if ( mask[bishopLocation+bishPosLDown[u]] & (mask[bishopLocation+bishPosLDown[u]] & *myPieces) ) {
-	  safetyBoard[bishopLocation+bishPosLDown[u]] += 1;
-	  break;
-	}
-	else if ( mask[bishopLocation+bishPosLDown[u]] & (mask[bishopLocation+bishPosLDown[u]] & oponents) ) {
-	  myMove.dest = mask[bishopLocation+bishPosLDown[u]];
-
-	  if (curPos.square[bishopLocation+bishPosLDown[u]].getPiece() == KING)
-	    checks++;
-
-	  captures.push_back(myMove);
-	  break;
-	}
-      }
-    }
-    for (int u = 0; u < 7 - COL(bishopLocation); u++) {
-      if ( bishopLocation + bishPosRUp[u] < 64 && bishopLocation + bishPosRUp[u] >= 0 ) {
-	if ( mask[bishopLocation+bishPosRUp[u]] & (mask[bishopLocation+bishPosRUp[u]] & *myPieces) ) {
-	  safetyBoard[bishopLocation+bishPosRUp[u]] += 1;
-	  break;
-	}
-	else if ( mask[bishopLocation+bishPosRUp[u]] & oponents ) {
-	  myMove.dest = mask[bishopLocation+bishPosRUp[u]];
-
-	  if (curPos.square[bishopLocation+bishPosRUp[u]].getPiece() == KING)
-	    checks++;
-
-	  captures.push_back(myMove);
-	  break;
-	}
-      }
-    }
-    for (int u = 0; u < 7 - COL(bishopLocation); u++) {
-      if ( bishopLocation + bishPosRDown[u] < 64 && bishopLocation + bishPosRDown[u] >= 0 ) {
-	if ( mask[bishopLocation+bishPosRDown[u]] & (mask[bishopLocation+bishPosRDown[u]] & *myPieces) ) {
-	  safetyBoard[bishopLocation+bishPosRDown[u]] += 1;
-	  break;
-	}
-	else if ( mask[bishopLocation+bishPosRDown[u]] & (mask[bishopLocation+bishPosRDown[u]] & oponents) ) {
-	  myMove.dest = mask[bishopLocation+bishPosRDown[u]];
-
-	  if (curPos.square[bishopLocation+bishPosRDown[u]].getPiece() == KING)
-	    checks++;
-
-	  captures.push_back(myMove);
-	  break;
-	}
-      }
-    }
-
-    return captures;
+  template<int Backend> void Board::genBishopCaptures(int bishopLocation, MoveList& captures) {
+    addCaptures(captures, bishopLocation, bishopAttacks<Backend>(bishopLocation, curPos.colors[WHITE]|curPos.colors[BLACK]));
   }
 
 
   /** This method generates a list of possible moves for a queen on location queenLocation.
    *  @param queenLocation an integer that represents the current queen location on a bit board
-   *  @return a vector containing the list of possible queen moves
+   *  @param moves is the list the possible queen moves are appended to
    */
-  vector<BitBoardMove> Board::genQueenMoves(int queenLocation) {
-    vector<BitBoardMove> diagonal;
-    vector<BitBoardMove> straight;
-    vector<BitBoardMove> allQMoves;
-    diagonal = genBishopMoves(queenLocation);
-    straight = genRookMoves(queenLocation);
-    allQMoves = diagonal;
-    allQMoves.insert(allQMoves.end(), straight.begin(), straight.end());
-    return allQMoves;
+  template<int Backend> void Board::genQueenMoves(int queenLocation, MoveList& moves) {
+    BitBoard occupied = curPos.colors[WHITE]|curPos.colors[BLACK];
+    addMoves(moves, queenLocation, queenAttacks<Backend>(queenLocation, occupied) & ~occupied);
   }
 
 
@@ -727,44 +812,19 @@ namespace brd {
    *  @see getSafetyBoard()
    *  @see getChecks()
    *  @param queenLocation an integer that represents the current rook location on a bit board
-   *  @return a vector containing the list of possible queen captures
+   *  @param captures is the list the possible queen captures are appended to
    */
-  vector<BitBoardMove> Board::genQueenCaptures(int queenLocation) {
-    vector<BitBoardMove> diagonal;
-    vector<BitBoardMove> straight;
-    vector<BitBoardMove> allQCaps;
-    diagonal = genBishopCaptures(queenLocation);
-    straight = genRookCaptures(queenLocation);
-    allQCaps = diagonal;
-    allQCaps.insert(allQCaps.end(), straight.begin(), straight.end());
-    return allQCaps;
+  template<int Backend> void Board::genQueenCaptures(int queenLocation, MoveList& captures) {
+    addCaptures(captures, queenLocation, queenAttacks<Backend>(queenLocation, curPos.colors[WHITE]|curPos.colors[BLACK]));
   }
 
 
   /** This method generates a list of possible moves for a king on location kingLocation.
    *  @param bishopLocation an integer that represents the current king location on a bit board
-   *  @return a vector containing the list of possible king moves
+   *  @param moves is the list the possible king moves are appended to
    */
-  vector<BitBoardMove> Board::genKingMoves(int kingLocation) {
-    vector<BitBoardMove> moves;
-    BitBoardMove myMove;
-    myMove.source = mask[kingLocation];
-    
-    for (int u = 0; u < 8; u++) {
-      if ( kingLocation + kingPos[u] < 64 && kingLocation + kingPos[u] >= 0 ) {
-	if  ( (abs(kingPos[u]) == 1 && !outOfBoundary(kingLocation, kingPos[u])) ||
-	      (COL(kingLocation) < 7 && (kingPos[u] == -7 || kingPos[u] == 9)) ||
-	      (COL(kingLocation) > 0 && (kingPos[u] == -9 || kingPos[u] == 7)) ||
-	      (abs(kingPos[u]) == 8) ) {
-	  if (mask[kingLocation+kingPos[u]] & ~(curPos.whitePieces|curPos.blackPieces)) {
-	    myMove.dest = mask[kingLocation+kingPos[u]];
-	    moves.push_back(myMove);
-	  }
-	}
-      }
-    }
-
-    return moves;
+  void Board::genKingMoves(int kingLocation, MoveList& moves) {
+    addMoves(moves, kingLocation, kingAttacks[kingLocation] & ~(curPos.colors[WHITE]|curPos.colors[BLACK]));
   }
 
 
@@ -772,80 +832,115 @@ namespace brd {
    *  It also sets the flags in a safety board to determine the other own pieces that are protected by the king.
    *  @see getSafetyBoard()
    *  @param kingLocation an integer that represents the current king location on a bit board
-   *  @return a vector containing the list of possible king captures
+   *  @param captures is the list the possible king captures are appended to
+   */
+  void Board::genKingCaptures(int kingLocation, MoveList& captures) {
+    addCaptures(captures, kingLocation, kingAttacks[kingLocation]);
+  }
+
+
+  /** This method generates a list of possible castlings for a king on location kingLocation.
+   *  Only castlings that are legal are generated: the king must not be in check and must neither pass nor land on
+   *  a square attacked by the opponent.
+   *  @param kingLocation an integer that represents the current king location on a bit board
+   *  @param castlings is the list the possible king castling moves are appended to
+   */
+  template<int Backend> void Board::genCastlingMoves(int kingLocation, MoveList& castlings) {
+    int color = curPos.square[kingLocation].getColor();
+    int them = color == WHITE ? BLACK : WHITE;
+    int west = color == WHITE ? CASTLING_WHITE_WEST : CASTLING_BLACK_WEST;
+    int east = color == WHITE ? CASTLING_WHITE_EAST : CASTLING_BLACK_EAST;
+
+    if (!(curPos.castling & (west | east)) || isAttacked<Backend>(kingLocation, them))
+      return;
+
+    // We only generate the according 2-field move for the king and leave the move of the rook up to makeMove()
+    if ( (curPos.castling & west) && !(betweenSquares[kingLocation][kingLocation - 4] & curPos.occupied()) &&
+	 !isAttacked<Backend>(kingLocation - 1, them) && !isAttacked<Backend>(kingLocation - 2, them) )
+      castlings.push_back(PackedMove(kingLocation, kingLocation - 2, MOVE_CASTLING));
+    if ( (curPos.castling & east) && !(betweenSquares[kingLocation][kingLocation + 3] & curPos.occupied()) &&
+	 !isAttacked<Backend>(kingLocation + 1, them) && !isAttacked<Backend>(kingLocation + 2, them) )
+      castlings.push_back(PackedMove(kingLocation, kingLocation + 2, MOVE_CASTLING));
+  }
+  
+
+  //! Append a move from location to every square in targets.
+  /** @param moves is the list the new moves are appended to
+   *  @param location is the square the moving piece stands on
+   *  @param targets is a bit board of all destination squares
+   */
+  void Board::addMoves(MoveList& moves, int location, BitBoard targets) {
+    while (targets) {
+      moves.push_back(PackedMove(location, firstBit(targets)));
+      targets &= targets - 1;
+    }
+  }
+
+
+  //! Turn the attacks of the piece on location into captures, piece safety and checks.
+  /** Every attacked opponent piece becomes a capture (and a check if it is the king), every attacked
+   *  own piece is counted as protected in the safety board.
+   *  @see getSafetyBoard()
+   *  @see getChecks()
+   *  @param captures is the list the new captures are appended to
+   *  @param location is the square the attacking piece stands on
+   *  @param attacks is a bit board of all squares the piece attacks
    */
-  vector<BitBoardMove> Board::genKingCaptures(int kingLocation) {
-    vector<BitBoardMove> captures;
-    BitBoardMove myMove;
-    BitBoard oponents = 0, *myPieces;
-    myMove.source = mask[kingLocation];
+  void Board::addCaptures(MoveList& captures, int location, BitBoard attacks) {
+    BitBoard myPieces, oponents, targets;
 
-    if (curTurn == WHITE) {
-      myPieces = &curPos.whitePieces;
-      oponents = curPos.blackPieces;
+    if (curPos.side == WHITE) {
+      myPieces = curPos.colors[WHITE];
+      oponents = curPos.colors[BLACK];
     }
     else {
-      oponents = curPos.whitePieces;
-      myPieces = &curPos.blackPieces;
+      myPieces = curPos.colors[BLACK];
+      oponents = curPos.colors[WHITE];
     }
 
-    for (int u = 0; u < 8; u++) {
-      if ( kingLocation + kingPos[u] < 64 && kingLocation + kingPos[u] >= 0 ) {
-	if  ( (abs(kingPos[u]) == 1 && !outOfBoundary(kingLocation, kingPos[u])) ||
-	      (COL(kingLocation) < 7 && (kingPos[u] == -7 || kingPos[u] == 9)) ||
-	      (COL(kingLocation) > 0 && (kingPos[u] == -9 || kingPos[u] == 7)) ||
-	      (abs(kingPos[u]) == 8) ) {
-	  if (mask[kingLocation+kingPos[u]] & oponents) {
-	    myMove.dest = mask[kingLocation+kingPos[u]];
-	    captures.push_back(myMove);
-	  }
-	  else if (mask[kingLocation+kingPos[u]] & *myPieces)
-	    safetyBoard[kingLocation+kingPos[u]] += 1;
-	}
-      }
+    for (targets = attacks & myPieces; targets; targets &= targets - 1)
+      safetyBoard[firstBit(targets)] += 1;
+
+    for (targets = attacks & oponents; targets; targets &= targets - 1) {
+      int dest = firstBit(targets);
+
+      if (curPos.square[dest].getPiece() == KING)
+	checks++;
+
+      captures.push_back(PackedMove(location, dest));
     }
-    
-    return captures;
   }
 
 
-  /** This method generates a list of possible castlings for a king on location kingLocation.
-   *  @param kingLocation an integer that represents the current king location on a bit board
-   *  @return a vector containing the list of possible king castling moves
+  //! Append a pawn move, or all four promotions if the pawn reaches the last row.
+  /** @param moves is the list the new moves are appended to
+   *  @param source is the square the pawn stands on
+   *  @param dest is the square the pawn moves to
    */
-  vector<BitBoardMove> Board::genCastlingMoves(int kingLocation) {
-    vector<BitBoardMove> castlings;
-    BitBoardMove myMove;
-
-    // We only generate the according 2-field move for the king and leave the move of the rook up to makeMove()
-    if ( (curPos.square[kingLocation].getColor() == BLACK) && (curPos.blackCastlingEast || curPos.blackCastlingWest) ) {
-      if (curPos.square[1].getColor() == EMPTY && curPos.square[2].getColor() == EMPTY && curPos.square[3].getColor() == EMPTY && curPos.blackCastlingWest) {
-	myMove.source = mask[kingLocation];
-	myMove.dest = mask[2];
-	castlings.push_back(myMove);
-      }
-      else if (curPos.square[5].getColor() == EMPTY && curPos.square[6].getColor() == EMPTY && curPos.blackCastlingEast) {
-	myMove.source = mask[kingLocation];
-	myMove.dest = mask[6];
-	castlings.push_back(myMove);
-      }
-    }
-    else if ( (curPos.square[kingLocation].getColor() == WHITE) && (curPos.whiteCastlingEast || curPos.whiteCastlingWest) ) {
-      if (curPos.square[57].getColor() == EMPTY && curPos.square[58].getColor() == EMPTY && curPos.square[59].getColor() == EMPTY && curPos.whiteCastlingWest) {
-	myMove.source = mask[kingLocation];
-	myMove.dest = mask[58];
-	castlings.push_back(myMove);
-      }
-      else if (curPos.square[61].getColor() == EMPTY && curPos.square[62].getColor() == EMPTY && curPos.whiteCastlingEast) {
-	myMove.source = mask[kingLocation];
-	myMove.dest = mask[62];
-	castlings.push_back(myMove);
-      }      
+  void Board::addPawnMove(MoveList& moves, int source, int dest) {
+    if (ROW(dest) == 0 || ROW(dest) == 7) {
+      moves.push_back(PackedMove(source, dest, MOVE_PROMOTION, QUEEN));
+      moves.push_back(PackedMove(source, dest, MOVE_PROMOTION, KNIGHT));
+      moves.push_back(PackedMove(source, dest, MOVE_PROMOTION, ROOK));
+      moves.push_back(PackedMove(source, dest, MOVE_PROMOTION, BISHOP));
     }
+    else
+      moves.push_back(PackedMove(source, dest));
+  }
 
-    return castlings;
+
+  //! Append a pawn move for every square in targets, coming from offset squares behind it.
+  /** @param moves is the list the new moves are appended to
+   *  @param targets is a bit board of all destination squares
+   *  @param offset is the distance from the source square to the destination square
+   */
+  void Board::addPawnMoves(MoveList& moves, BitBoard targets, int offset) {
+    while (targets) {
+      int dest = popFirstBit(targets);
+      addPawnMove(moves, dest - offset, dest);
+    }
   }
-  
+
 
   //! Check whether the chess piece on a certain location can move by offset bits.
   /** This method checks whether it is possible for the chess piece on a given location, to move
@@ -858,50 +953,21 @@ namespace brd {
     // White pawns can either move -8 or -16, black pawns can do 8 or 16 bits on the board
     // Everything else is not legal (unless it's a capture or promotion which is handled by other functions)
     if ( (getTurn() == WHITE) && (offset == -8) ) {
-      if ( (ROW(pawnLocation) > 0) && (mask[pawnLocation-8] & ~(curPos.whitePieces|curPos.blackPieces)) )
-	return true;
-    }
-    else if ( (getTurn() == WHITE) && (offset == -16) ) {
-      if ( (ROW(pawnLocation) == 6) && (mask[pawnLocation-8] & ~(curPos.whitePieces|curPos.blackPieces)) && 
-	   (mask[pawnLocation-16] & ~(curPos.whitePieces|curPos.blackPieces)) )
-	return true;
-    }
-    else if ( (getTurn() == BLACK) && (offset == 8) ) {
-      if ( (ROW(pawnLocation) < 7) && (mask[pawnLocation+8] & ~(curPos.whitePieces|curPos.blackPieces)) )
-	return true;
-    }
-    else if ( (getTurn() == BLACK) && (offset == 16) ) {
-      if ( (ROW(pawnLocation) == 1) && (mask[pawnLocation+8] & ~(curPos.whitePieces|curPos.blackPieces)) &&
-	   (mask[pawnLocation+16] & ~(curPos.whitePieces|curPos.blackPieces)) )
-	return true;
-    }
-    
-    return false;
-  }
-
-
-  //! Check whether the chess piece on a certain location is able to capture the opponent's pieces, located offset bits away from the attacker.
-  /** This method checks whether it is possible for the chess piece on a given location, to capture the opponent, which is located
-   *  offsets bit away from the attacker.
-   *  @param pawnLocation is the current location of the chess piece
-   *  @param offset is the number of bits the piece wants to move over the bit board
-   *  @return true if the capture is possible and legal, false otherwise
-   */
-  bool Board::possiblePawnCapture(int pawnLocation, int offset) {
-    if ( (getTurn() == WHITE) && (offset == -7) ) {
-      if ( COL(pawnLocation) < 7 && (pawnLocation-7 >= 0) && (mask[pawnLocation-7] & curPos.blackPieces) )
+      if ( (ROW(pawnLocation) > 0) && (squareMask[pawnLocation-8] & ~(curPos.colors[WHITE]|curPos.colors[BLACK])) )
 	return true;
     }
-    else if ( (getTurn() == WHITE) && (offset == -9) ) {
-      if ( COL(pawnLocation) > 0 && (pawnLocation - 9 >= 0) && (mask[pawnLocation-9] & curPos.blackPieces) )
+    else if ( (getTurn() == WHITE) && (offset == -16) ) {
+      if ( (ROW(pawnLocation) == 6) && (squareMask[pawnLocation-8] & ~(curPos.colors[WHITE]|curPos.colors[BLACK])) && 
+	   (squareMask[pawnLocation-16] & ~(curPos.colors[WHITE]|curPos.colors[BLACK])) )
 	return true;
     }
-    else if ( (getTurn() == BLACK) && (offset == 7) ) {
-      if ( COL(pawnLocation) < 7 && (pawnLocation + 9 < 64) && (mask[pawnLocation+9] & curPos.whitePieces) )
+    else if ( (getTurn() == BLACK) && (offset == 8) ) {
+      if ( (ROW(pawnLocation) < 7) && (squareMask[pawnLocation+8] & ~(curPos.colors[WHITE]|curPos.colors[BLACK])) )
 	return true;
     }
-    else if ( (getTurn() == BLACK) && (offset == 9) ) {
-      if ( COL(pawnLocation) < 7 && (pawnLocation + 9 < 64) && (mask[pawnLocation+9] & curPos.whitePieces) )
+    else if ( (getTurn() == BLACK) && (offset == 16) ) {
+      if ( (ROW(pawnLocation) == 1) && (squareMask[pawnLocation+8] & ~(curPos.colors[WHITE]|curPos.colors[BLACK])) &&
+	   (squareMask[pawnLocation+16] & ~(curPos.colors[WHITE]|curPos.colors[BLACK])) )
 	return true;
     }
     
@@ -909,10 +975,131 @@ namespace brd {
   }
 
 
+  //! Put a piece on an empty square and update the bit boards and hash keys accordingly.
+  void Board::putPiece(int color, int piece, int sq) {
+    curPos.pieces[piece] ^= squareMask[sq];
+    curPos.colors[color] ^= squareMask[sq];
+    curPos.hash ^= zobristPieces[color][piece][sq];
+    if (piece == PAWN)
+      curPos.pawnHash ^= zobristPieces[color][piece][sq];
+    curPos.square[sq].setColor(color);
+    curPos.square[sq].setPiece(piece);
+  }
+
+
+  //! Take the piece on a square off the board and update the bit boards and hash keys accordingly.
+  void Board::removePiece(int sq) {
+    int color = curPos.square[sq].getColor(), piece = curPos.square[sq].getPiece();
+
+    curPos.pieces[piece] ^= squareMask[sq];
+    curPos.colors[color] ^= squareMask[sq];
+    curPos.hash ^= zobristPieces[color][piece][sq];
+    if (piece == PAWN)
+      curPos.pawnHash ^= zobristPieces[color][piece][sq];
+    curPos.square[sq].setColor(EMPTY);
+    curPos.square[sq].setPiece(EMPTY);
+  }
+
+
   //! Take back the last move.
+  /** Only the squares touched by the move are restored, using the undo record stored by makeMove().
+   *  @see makeMove()
+   */
   void Board::undoMove(void) {
-    curPos = *(history.end() - 1);
+    const UndoInfo& undo = history.back();
+    int source = undo.move.source(), dest = undo.move.dest();
+    int movedColor = curPos.square[dest].getColor();
+    int movedPiece = curPos.square[dest].getPiece();
+
+    // Move the piece back, a promoted piece becomes a pawn again
+    removePiece(dest);
+    putPiece(movedColor, undo.move.type() == MOVE_PROMOTION ? PAWN : movedPiece, source);
+
+    // The pawn taken en passant stands behind the destination square
+    if (undo.move.type() == MOVE_ENPASSANT)
+      putPiece(movedColor == WHITE ? BLACK : WHITE, PAWN, movedColor == WHITE ? dest + 8 : dest - 8);
+    else if (undo.captured != EMPTY)
+      putPiece(movedColor == WHITE ? BLACK : WHITE, undo.captured, dest);
+
+    // Move the rook back to its corner after a castling move
+    if (undo.move.type() == MOVE_CASTLING) {
+      if (dest > source) {
+	removePiece(source + 1);
+	putPiece(movedColor, ROOK, source + 3);
+      }
+      else {
+	removePiece(source - 1);
+	putPiece(movedColor, ROOK, source - 4);
+      }
+    }
+
+    // The pieces have updated the hash keys already, the rest of the position is switched back here
+    curPos.hash ^= zobristCastling[curPos.castling] ^ zobristCastling[undo.castling];
+    if (curPos.epSquare != NO_SQUARE)
+      curPos.hash ^= zobristEnPassant[COL(curPos.epSquare)];
+    if (undo.epSquare != NO_SQUARE)
+      curPos.hash ^= zobristEnPassant[COL(undo.epSquare)];
+
+    curPos.castling = undo.castling;
+    curPos.epSquare = undo.epSquare;
+
+    history.pop_back();
+
+#ifdef DEBUG
+    checkHash();
+#endif
+  }
+
+
+  //! Pass the right to move to the opponent without moving a piece.
+  /** Unlike makeMove(), this changes the side to move. An en passant capture is no longer possible afterwards.
+   *  @see undoNullMove()
+   */
+  void Board::makeNullMove(void) {
+    UndoInfo undo;
+
+    undo.move = PackedMove(0, 0);
+    undo.captured = EMPTY;
+    undo.castling = curPos.castling;
+    undo.epSquare = curPos.epSquare;
+    history.push_back(undo);
+
+    if (curPos.epSquare != NO_SQUARE)
+      curPos.hash ^= zobristEnPassant[COL(curPos.epSquare)];
+    curPos.epSquare = NO_SQUARE;
+
+    curPos.side = (curPos.side == WHITE ? BLACK : WHITE);
+    curPos.hash ^= zobristSide;
+
+#ifdef DEBUG
+    checkHash();
+#endif
+  }
+
+
+  //! Take back a move made by makeNullMove().
+  void Board::undoNullMove(void) {
+    curPos.epSquare = history.back().epSquare;
+    if (curPos.epSquare != NO_SQUARE)
+      curPos.hash ^= zobristEnPassant[COL(curPos.epSquare)];
+
+    curPos.side = (curPos.side == WHITE ? BLACK : WHITE);
+    curPos.hash ^= zobristSide;
+
     history.pop_back();
+
+#ifdef DEBUG
+    checkHash();
+#endif
+  }
+
+
+  //! Check whether a side has any pieces left besides its king and pawns.
+  /** @param color is WHITE or BLACK
+   *  @return true if color has at least one knight, bishop, rook or queen
+   */
+  bool Board::hasPieces(int color) {
+    return (curPos.colors[color] & ~(curPos.pieces[PAWN] | curPos.pieces[KING])) != 0;
   }
 
 
@@ -922,228 +1109,77 @@ namespace brd {
    *  @see undoMove()
    */
   void Board::makeMove(Move newMove) {
-    int row = newMove.source().y * 8;
-    int offset = newMove.source().x;
-    int source = row + offset, dest = 0;
-    row = newMove.dest().y * 8;
-    offset = newMove.dest().x;
-    dest = row + offset;
+    makeMove(toPackedMove(newMove));
+  }
+
+
+  //! Make a move, given in its packed form, on the chess board
+  /** This is the version of makeMove() used by the search, with moves straight from the move generator.
+   *  Only the bit boards of the pieces involved are updated, and a small undo record with whatever cannot be
+   *  recovered from the move itself (the captured piece, the castling rights and the en passant square) is stored
+   *  in the history. The hash keys are updated along with the pieces.
+   *  @param newMove is the move that has to be made
+   *  @see undoMove()
+   */
+  void Board::makeMove(PackedMove newMove) {
+    int source = newMove.source(), dest = newMove.dest();
     int movedPiece = curPos.square[source].getPiece();
     int movedColor = curPos.square[source].getColor();
-
-    // Store current position in the history
-    history.push_back(curPos);
-
-    // Clear destination location
-    if (movedColor == WHITE) {
-      if (curPos.square[dest].getPiece() != EMPTY) {
-	curPos.blackPieces ^= mask[dest];
-	curPos.blackPawns ^= mask[dest];
-	curPos.blackQueens ^= mask[dest];
-	curPos.blackKing ^= mask[dest];
-	curPos.blackRooks ^= mask[dest];
-	curPos.blackBishops ^= mask[dest];
-	curPos.blackKnights ^= mask[dest];
-      }
-    }
-    else {
-      if (curPos.square[dest].getPiece() != EMPTY) {
-	curPos.whitePieces ^= mask[dest];
-	curPos.whitePawns ^= mask[dest];
-	curPos.whiteQueens ^= mask[dest];
-	curPos.whiteKing ^= mask[dest];
-	curPos.whiteRooks ^= mask[dest];
-	curPos.whiteBishops ^= mask[dest];
-	curPos.whiteKnights ^= mask[dest];
+    UndoInfo undo;
+
+    // Store what is needed to take the move back in the history
+    undo.move = newMove;
+    undo.captured = newMove.type() == MOVE_ENPASSANT ? PAWN : curPos.square[dest].getPiece();
+    undo.castling = curPos.castling;
+    undo.epSquare = curPos.epSquare;
+    history.push_back(undo);
+
+    // Clear destination location, or the square behind it for an en passant capture
+    if (newMove.type() == MOVE_ENPASSANT)
+      removePiece(movedColor == WHITE ? dest + 8 : dest - 8);
+    else if (undo.captured != EMPTY)
+      removePiece(dest);
+
+    // Move the piece, a pawn reaching the last row is replaced by the piece it is promoted to
+    removePiece(source);
+    putPiece(movedColor, newMove.type() == MOVE_PROMOTION ? newMove.promotion() : movedPiece, dest);
+
+    // Check if king is doing castling move, i.e. king moves by 2 bits on the board
+    if (newMove.type() == MOVE_CASTLING) {
+      if (dest > source) {             // East
+	removePiece(source + 3);
+	putPiece(movedColor, ROOK, source + 1);
       }
-    }
-
-    // Set new position
-    if (movedColor == WHITE) {
-      switch (movedPiece) {
-      case PAWN:
-	curPos.whitePieces |= mask[dest];
-	if (ROW(dest) == 0)
-	  curPos.whiteQueens |= mask[dest];
-	else
-	  curPos.whitePawns |= mask[dest];
-	break;
-      case ROOK:
-	curPos.whitePieces |= mask[dest];
-	curPos.whiteRooks |= mask[dest];
-	break;
-      case KNIGHT:
-	curPos.whitePieces |= mask[dest];
-	curPos.whiteKnights |= mask[dest];
-	break;
-      case BISHOP:
-	curPos.whitePieces |= mask[dest];
-	curPos.whiteBishops |= mask[dest];
-	break;
-      case QUEEN:
-	curPos.whitePieces |= mask[dest];
-	curPos.whiteQueens |= mask[dest];
-	break;
-      case KING:
-	curPos.whitePieces |= mask[dest];
-	curPos.whiteKing |= mask[dest];
-	
-	// Check if king is doing castling move, i.e. king moves by 2 bits on the board
-	if (dest - source == 2) {               // East
-	  curPos.whitePieces |= mask[61];
-	  curPos.whiteRooks |= mask[61];
-	  curPos.whiteRooks ^= mask[63];
-	  curPos.whitePieces ^= mask[63];
-	  curPos.square[63].setPiece(EMPTY);
-	  curPos.square[63].setColor(EMPTY);
-	  curPos.square[61].setPiece(ROOK);
-	  curPos.square[61].setColor(WHITE);
-	}
-	else if (dest - source == -2) {         // West
-	  curPos.whitePieces |= mask[59];
-	  curPos.whiteRooks |= mask[59];
-	  curPos.whiteRooks ^= mask[56];
-	  curPos.whitePieces ^= mask[56];
-	  curPos.square[56].setPiece(EMPTY);
-	  curPos.square[56].setColor(EMPTY);
-	  curPos.square[59].setPiece(ROOK);
-	  curPos.square[59].setColor(WHITE);
-	}
-
-	break;
+      else {                           // West
+	removePiece(source - 4);
+	putPiece(movedColor, ROOK, source - 1);
       }
     }
-    else if (movedColor == BLACK) {
-      switch (movedPiece) {
-      case PAWN:
-	curPos.blackPieces |= mask[dest];
-	if (ROW(dest) == 7)
-	  curPos.blackQueens |= mask[dest];
-	else
-	  curPos.blackPawns |= mask[dest];
-	break;
-      case ROOK:
-	curPos.blackPieces |= mask[dest];
-	curPos.blackRooks |= mask[dest];
-	break;
-      case KNIGHT:
-	curPos.blackPieces |= mask[dest];
-	curPos.blackKnights |= mask[dest];
-	break;
-      case BISHOP:
-	curPos.blackPieces |= mask[dest];
-	curPos.blackBishops |= mask[dest];
-	break;
-      case QUEEN:
-	curPos.blackPieces |= mask[dest];
-	curPos.blackQueens |= mask[dest];
-	break;
-      case KING:
-	curPos.blackPieces |= mask[dest];
-	curPos.blackKing |= mask[dest];
-
-	// Check if king is doing castling move, i.e. king moves by 2 bits on the board
-	if (dest - source == 2) {               // East
-	  curPos.blackPieces |= mask[5];
-	  curPos.blackRooks |= mask[5];
-	  curPos.blackRooks ^= mask[7];
-	  curPos.blackPieces ^= mask[7];
-	  curPos.square[7].setPiece(EMPTY);
-	  curPos.square[7].setColor(EMPTY);
-	  curPos.square[5].setPiece(ROOK);
-	  curPos.square[5].setColor(BLACK);
-	}
-	else if (dest - source == -2) {         // West
-	  curPos.blackPieces |= mask[3];
-	  curPos.blackRooks |= mask[3];
-	  curPos.blackRooks ^= mask[0];
-	  curPos.blackPieces ^= mask[0];
-	  curPos.square[0].setPiece(EMPTY);
-	  curPos.square[0].setColor(EMPTY);
-	  curPos.square[3].setPiece(ROOK);
-	  curPos.square[3].setColor(BLACK);
-	}
 
-	break;
-      }
+    // A pawn moving two rows forward can be captured en passant on the square it passed
+    if (curPos.epSquare != NO_SQUARE)
+      curPos.hash ^= zobristEnPassant[COL(curPos.epSquare)];
+    if (movedPiece == PAWN && (dest - source == 16 || source - dest == 16)) {
+      curPos.epSquare = (source + dest) / 2;
+      curPos.hash ^= zobristEnPassant[COL(curPos.epSquare)];
     }
-    curPos.square[dest].setColor(movedColor);
-    if ( (curPos.square[source].getPiece() == PAWN) && ((getTurn() == WHITE && ROW(dest) == 0) || (getTurn() == BLACK && ROW(dest) == 7)) )
-      curPos.square[dest].setPiece(QUEEN);
     else
-      curPos.square[dest].setPiece(movedPiece);
-    
-    // Clear old position
-    if (movedColor == WHITE) {
-      switch (movedPiece) {
-      case PAWN:
-	curPos.whitePieces ^= mask[source];
-	curPos.whitePawns ^= mask[source];
-	break;
-      case ROOK:
-	if (ROW(source) == 7 && COL(source) == 0)
-	  curPos.whiteCastlingWest = false;
-	else if (ROW(source) == 7 && COL(source) == 7)
-	  curPos.whiteCastlingEast = false;
-	curPos.whitePieces ^= mask[source];
-	curPos.whiteRooks ^= mask[source];
-	break;
-      case KNIGHT:
-	curPos.whitePieces ^= mask[source];
-	curPos.whiteKnights ^= mask[source];
-	break;
-      case BISHOP:
-	curPos.whitePieces ^= mask[source];
-	curPos.whiteBishops ^= mask[source];
-	break;
-      case QUEEN:
-	curPos.whitePieces ^= mask[source];
-	curPos.whiteQueens ^= mask[source];
-	break;
-      case KING:
-	curPos.whiteCastlingEast = false;
-	curPos.whiteCastlingWest = false;
-	curPos.whitePieces ^= mask[source];
-	curPos.whiteKing ^= mask[source];
-	break;
-      }
-    }
-    else if (movedColor == BLACK) {
-      switch (movedPiece) {
-      case PAWN:
-	curPos.blackPieces ^= mask[source];
-	curPos.blackPawns ^= mask[source];
-	break;
-      case ROOK:
-	if (ROW(source) == 0 && COL(source) == 0)
-	  curPos.blackCastlingWest = false;
-	else if (ROW(source) == 0 && COL(source) == 7)
-	  curPos.blackCastlingEast = false;
-	curPos.blackPieces ^= mask[source];
-	curPos.blackRooks ^= mask[source];
-	break;
-      case KNIGHT:
-	curPos.blackPieces ^= mask[source];
-	curPos.blackKnights ^= mask[source];
-	break;
-      case BISHOP:
-	curPos.blackPieces ^= mask[source];
-	curPos.blackBishops ^= mask[source];
-	break;
-      case QUEEN:
-	curPos.blackPieces ^= mask[source];
-	curPos.blackQueens ^= mask[source];
-	break;
-      case KING:
-	curPos.blackCastlingEast = false;
-	curPos.blackCastlingWest = false;
-	curPos.blackPieces ^= mask[source];
-	curPos.blackKing ^= mask[source];
-	break;
-      }
-    }
-    curPos.square[source].setPiece(EMPTY);
-    curPos.square[source].setColor(EMPTY);
+      curPos.epSquare = NO_SQUARE;
+
+    // Moving the king, or moving or capturing a rook in its corner, ends castling on that side
+    if (source == 60 || source == 56 || dest == 56)
+      curPos.castling &= ~CASTLING_WHITE_WEST;
+    if (source == 60 || source == 63 || dest == 63)
+      curPos.castling &= ~CASTLING_WHITE_EAST;
+    if (source == 4 || source == 0 || dest == 0)
+      curPos.castling &= ~CASTLING_BLACK_WEST;
+    if (source == 4 || source == 7 || dest == 7)
+      curPos.castling &= ~CASTLING_BLACK_EAST;
+    curPos.hash ^= zobristCastling[undo.castling] ^ zobristCastling[curPos.castling];
+
+#ifdef DEBUG
+    checkHash();
+#endif
   }
 
 
@@ -1154,13 +1190,23 @@ namespace brd {
    *  @return true if the move is legal and possible, false otherwise
    */
   bool Board::isValidMove(Move aMove) {
-    if ((int)curPos.square[aMove.source().y * 8 + aMove.source().x].getColor() != getTurn())
+    return isValidMove(toPackedMove(aMove));
+  }
+
+
+  //! Check whether a move, given in its packed form, is really legal or not
+  /** @param aMove is the move that has to be checked
+   *  @return true if the move is legal and possible, false otherwise
+   *  @see isValidMove(Move)
+   */
+  bool Board::isValidMove(PackedMove aMove) {
+    if ((int)curPos.square[aMove.source()].getColor() != getTurn())
       return false;           // Player tried to move wrong piece, return false
 
     if (isCheckSituation(aMove))
       return false;           // Return false if the current move would lead into a check mate situation
 
-    switch(curPos.square[aMove.source().y * 8 + aMove.source().x].getPiece()) {
+    switch(curPos.square[aMove.source()].getPiece()) {
     case PAWN:
     case ROOK:
     case KNIGHT:
@@ -1178,76 +1224,19 @@ namespace brd {
 
   //! Check if a move would lead the current player into check mate
   /** This method checks whether a new move would lead the current player into a check mate
-   *  and therefore if the move is legal or not.
+   *  and therefore if the move is legal or not. The move does not have to be made for this.
    *  @param aMove is the move which is about to be made and that has to be checked
    *  @return true if the move does not expose the king to the opponent, false otherwise
    */
-  bool Board::isCheckSituation(Move aMove) {
-    Board vBoard;
-    
-    vBoard.setBoard(getBoard());
-    vBoard.makeMove(aMove);
-
-    if (getTurn() == WHITE)
-      vBoard.setTurn(BLACK);
-    else
-      vBoard.setTurn(WHITE);
-
-    for (int i = 0; i < 64; i++) {
-      if ((int)vBoard.getBoard().square[i].getColor() == vBoard.getTurn()) {
-	switch (vBoard.getBoard().square[i].getPiece()) {
-	case PAWN:
-	  vBoard.genPawnCaptures(i);
-	  break;
-	case ROOK:
-	  vBoard.genRookCaptures(i);
-	  break;
-	case KNIGHT:
-	  vBoard.genKnightCaptures(i);
-	  break;
-	case BISHOP:
-	  vBoard.genBishopCaptures(i);
-	  break;
-	case QUEEN:
-	  vBoard.genQueenCaptures(i);
-	  break;
-	}
-      }
-      
-      if (vBoard.getChecks() > 0)
-	return true;
-    }
-
-    return false;
-  }
-
-
-  //! Check whether a move leads us right out of the boundaries of the chess board
-  /** This method is to check whether a move from position by moveLength bits leads
-   *  right out of the borders of the current chess board.
-   *  Checking is actually done via the infamous mailbox-Matrix that is also implemented
-   *  in T. Kerrigans's simple chess programm.
-   *  @param position is the current's piece location on the board
-   *  @param moveLength is the number of bits this piece wants to move over the board
-   */
-  bool Board::outOfBoundary(int position, int moveLength) {
-    if (moveLength >= 1) {
-      for (int i = 1; i <= moveLength; i++)
-	if (mailbox[mailbox64[position]+i] == -1)
-	  return true;
-    }
-    else {
-      for (int i = -1; i >= moveLength; i--)
-	if (mailbox[mailbox64[position]+i] == -1)
-	  return true;
-    }
-    return false;
+  bool Board::isCheckSituation(PackedMove aMove) {
+    return !isLegal(aMove, pinnedPieces(curPos.side), checkMask());
   }
 
 
   //! Call this after every move a player has made to change turns
   void Board::nextTurn(void) {
-    curTurn == WHITE ? curTurn = BLACK : curTurn = WHITE;
+    curPos.side = (curPos.side == WHITE ? BLACK : WHITE);
+    curPos.hash ^= zobristSide;
 
     for (unsigned long i = 0; i < 64; i++)
       safetyBoard[i] = 0;
@@ -1259,7 +1248,7 @@ namespace brd {
    *  @return WHITE if player white is about to move, BLACK otherwise
    */
   int Board::getTurn(void) {
-    return curTurn;
+    return curPos.side;
   }
 
 
@@ -1268,7 +1257,238 @@ namespace brd {
    *  @param color is the color of the player/side that should move next (WHITE or BLACK)
    */
   void Board::setTurn(int color) {
-    curTurn = color;
+    if (curPos.side != color)
+      curPos.hash ^= zobristSide;
+    curPos.side = color;
+  }
+
+
+  //! Return the Zobrist hash key of the current position.
+  /** The key covers all pieces, the side to move, the castling rights and the en passant square. It is updated
+   *  incrementally by makeMove(), undoMove(), nextTurn() and setTurn().
+   *  @return The 64 bit hash key
+   *  @see computeHash()
+   */
+  u_int64_t Board::getHash(void) {
+    return curPos.hash;
+  }
+
+
+  //! Return the hash key of the pawns on the board alone.
+  u_int64_t Board::getPawnHash(void) {
+    return curPos.pawnHash;
+  }
+
+
+  //! Compute the Zobrist hash key of the current position from scratch.
+  /** @return The same key getHash() returns, if the incremental updates are correct
+   *  @see getHash()
+   */
+  u_int64_t Board::computeHash(void) {
+    u_int64_t key = zobristCastling[curPos.castling];
+
+    for (BitBoard occupied = curPos.occupied(); occupied; ) {
+      int i = popFirstBit(occupied);
+      key ^= zobristPieces[curPos.square[i].getColor()][curPos.square[i].getPiece()][i];
+    }
+
+    if (curPos.side == BLACK)
+      key ^= zobristSide;
+    if (curPos.epSquare != NO_SQUARE)
+      key ^= zobristEnPassant[COL(curPos.epSquare)];
+
+    return key;
+  }
+
+
+  //! Compute the hash key of the pawns from scratch.
+  u_int64_t Board::computePawnHash(void) {
+    u_int64_t key = 0;
+
+    for (int color = BLACK; color <= WHITE; color++)
+      for (BitBoard pawns = curPos.pieceBoard(color, PAWN); pawns; )
+	key ^= zobristPieces[color][PAWN][popFirstBit(pawns)];
+
+    return key;
+  }
+
+
+  //! Stop the program if the incrementally updated hash keys differ from keys computed from scratch.
+  void Board::checkHash(void) {
+    if (curPos.hash != computeHash() || curPos.pawnHash != computePawnHash()) {
+      cerr << "Board: hash keys out of sync with the position" << endl;
+      abort();
+    }
+  }
+
+
+  //! Count the leaf nodes of the legal move tree of the current position up to a given depth.
+  /** This is the standard way to verify a move generator: the counts for well known positions are published,
+   *  and every missing or extra move shows up in them.
+   *  @param depth is the number of plies to look ahead
+   *  @return The number of positions reached after exactly depth plies
+   *  @see perftDivide()
+   */
+  u_int64_t Board::perft(int depth) {
+    MoveList moves;
+    u_int64_t nodes = 0;
+    int side = curPos.side;
+
+    genLegalMoves(moves);
+    if (depth <= 1)
+      return depth == 1 ? moves.size() : 1;
+
+    for (int i = 0; i < moves.size(); i++) {
+      makeMove(moves[i]);
+      setTurn(side == WHITE ? BLACK : WHITE);
+      nodes += perft(depth - 1);
+      setTurn(side);
+      undoMove();
+    }
+
+    return nodes;
+  }
+
+
+  //! Like perft(), but print the number of leaf nodes below every move of the current position.
+  /** Comparing this list with the one of another program shows which move a bug hides behind.
+   *  @param depth is the number of plies to look ahead
+   *  @return The number of positions reached after exactly depth plies
+   *  @see perft()
+   */
+  u_int64_t Board::perftDivide(int depth) {
+    MoveList moves;
+    u_int64_t nodes = 0, count;
+    int side = curPos.side;
+
+    genLegalMoves(moves);
+
+    for (int i = 0; i < moves.size(); i++) {
+      makeMove(moves[i]);
+      setTurn(side == WHITE ? BLACK : WHITE);
+      count = depth > 1 ? perft(depth - 1) : 1;
+      setTurn(side);
+      undoMove();
+
+      cout << moveToString(moves[i]) << ": " << count << endl;
+      nodes += count;
+    }
+
+    return nodes;
+  }
+
+
+  //! Set up the board from a position in Forsyth-Edwards Notation.
+  /** Positions the move generators cannot handle are refused: each side needs exactly one king, the side not
+   *  to move must not be in check, a castling right needs the king and that rook on their initial squares,
+   *  and the en passant square has to be on the row behind a pawn that has just moved two squares.
+   *  @param fen is the position, e.g. "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+   *  @return false if fen could not be read, in which case the board has to be set up again before it is used
+   */
+  bool Board::setFen(string fen) {
+    const string pieces = "pnbrqk";
+    unsigned int pos = 0;
+    int rank = 0, file = 0;
+
+    for (int i = 0; i < 6; i++)
+      curPos.pieces[i] = 0;
+    curPos.colors[WHITE] = 0; curPos.colors[BLACK] = 0;
+    curPos.hash = 0; curPos.pawnHash = 0;
+    curPos.side = WHITE;
+    curPos.castling = 0;
+    curPos.epSquare = NO_SQUARE;
+    history.clear();
+    for (int i = 0; i < 64; i++) {
+      curPos.square[i].setColor(EMPTY);
+      curPos.square[i].setPiece(EMPTY);
+    }
+
+    // Pieces, from a8 to h1, each rank filled up to exactly eight files before the next one starts
+    for (; pos < fen.size() && fen[pos] != ' '; pos++) {
+      char c = fen[pos];
+
+      if (c == '/') {
+	if (file != 8 || ++rank == 8)
+	  return false;
+	file = 0;
+      }
+      else if (c >= '1' && c <= '8' && file + (c - '0') <= 8)
+	file += c - '0';
+      else if (pieces.find(tolower(c)) != string::npos && file < 8)
+	putPiece(isupper(c) ? WHITE : BLACK, pieces.find(tolower(c)), rank * 8 + file++);
+      else
+	return false;
+    }
+    if (rank != 7 || file != 8 || ++pos >= fen.size())
+      return false;
+
+    // Without exactly one king per side there are no pins and checks to look for
+    if (popCount(curPos.pieceBoard(WHITE, KING)) != 1 || popCount(curPos.pieceBoard(BLACK, KING)) != 1)
+      return false;
+
+    // Side to move
+    if (fen[pos] != 'w' && fen[pos] != 'b')
+      return false;
+    curPos.side = fen[pos] == 'b' ? BLACK : WHITE;
+    if (++pos < fen.size() && fen[pos++] != ' ')
+      return false;
+
+    // Castling rights
+    for (; pos < fen.size() && fen[pos] != ' '; pos++) {
+      switch (fen[pos]) {
+      case 'K': curPos.castling |= CASTLING_WHITE_EAST; break;
+      case 'Q': curPos.castling |= CASTLING_WHITE_WEST; break;
+      case 'k': curPos.castling |= CASTLING_BLACK_EAST; break;
+      case 'q': curPos.castling |= CASTLING_BLACK_WEST; break;
+      case '-': break;
+      default: return false;
+      }
+    }
+    pos++;
+
+    // Castling moves the king from e1/e8 and the rook from its corner, which have to be there
+    BitBoard whiteKing = curPos.pieceBoard(WHITE, KING), blackKing = curPos.pieceBoard(BLACK, KING);
+    BitBoard whiteRooks = curPos.pieceBoard(WHITE, ROOK), blackRooks = curPos.pieceBoard(BLACK, ROOK);
+
+    if (((curPos.castling & CASTLING_WHITE_WEST) && !(whiteKing & squareMask[60] && whiteRooks & squareMask[56])) ||
+	((curPos.castling & CASTLING_WHITE_EAST) && !(whiteKing & squareMask[60] && whiteRooks & squareMask[63])) ||
+	((curPos.castling & CASTLING_BLACK_WEST) && !(blackKing & squareMask[4] && blackRooks & squareMask[0])) ||
+	((curPos.castling & CASTLING_BLACK_EAST) && !(blackKing & squareMask[4] && blackRooks & squareMask[7])))
+      return false;
+
+    // The side to move could take the king of the other side
+    if (isAttacked(firstBit(curPos.pieceBoard(curPos.side == WHITE ? BLACK : WHITE, KING)), curPos.side))
+      return false;
+
+    // En passant square, behind a pawn of the side that has just moved
+    if (pos < fen.size() && fen[pos] != '-') {
+      int row = curPos.side == WHITE ? 2 : 5;
+      int pawnSq = row * 8 + (fen[pos] - 'a') + (curPos.side == WHITE ? 8 : -8);
+
+      if (pos + 1 >= fen.size() || fen[pos] < 'a' || fen[pos] > 'h' || fen[pos + 1] != '8' - row ||
+	  !(curPos.pieceBoard(curPos.side == WHITE ? BLACK : WHITE, PAWN) & squareMask[pawnSq]))
+	return false;
+      curPos.epSquare = row * 8 + (fen[pos] - 'a');
+    }
+
+    curPos.hash = computeHash();
+    curPos.pawnHash = computePawnHash();
+    return true;
+  }
+
+
+  //! Return a move in coordinate notation, e.g. "e2e4" or "e7e8q".
+  string Board::moveToString(PackedMove aMove) {
+    string text;
+
+    text += (char)('a' + COL(aMove.source()));
+    text += (char)('8' - ROW(aMove.source()));
+    text += (char)('a' + COL(aMove.dest()));
+    text += (char)('8' - ROW(aMove.dest()));
+    if (aMove.type() == MOVE_PROMOTION)
+      text += (char)tolower(pieceChar[aMove.promotion()]);
+
+    return text;
   }
 
 
@@ -1298,22 +1518,8 @@ namespace brd {
    *  @see makeMove()
    */
   void Board::doArrayMove(int pos) {
-    Move myMove;
-    Location myLocation;
-    double bit = 0;
-    
     // Check whether pos > allMoves.size() and throw if necessary
-    bit = LG(allMoves[pos].source);
-    myLocation.x = COL((int)rint(bit));
-    myLocation.y = ROW((int)rint(bit));
-    myMove.setSource(myLocation);
-
-    bit = LG(allMoves[pos].dest);
-    myLocation.x = COL((int)rint(bit));
-    myLocation.y = ROW((int)rint(bit));
-    myMove.setDest(myLocation);
-
-    makeMove(myMove);
+    makeMove(allMoves[pos]);
   }
 
   
@@ -1324,30 +1530,63 @@ namespace brd {
    *  @see genMoves()
    */
   Move Board::getArrayMove(int pos) {
+    return toMove(allMoves[pos]);
+  }
+
+
+  //! Convert a packed move into a move with x/y locations, as used by the players.
+  /** @param aMove is the packed move
+   *  @return The same move as a Move object
+   *  @see toPackedMove()
+   */
+  Move Board::toMove(PackedMove aMove) {
     Move myMove;
     Location myLocation;
-    double bit = 0;
 
-    bit = LG(allMoves[pos].source);
-    myLocation.x = COL((int)rint(bit));
-    myLocation.y = ROW((int)rint(bit));
+    myLocation.x = COL(aMove.source());
+    myLocation.y = ROW(aMove.source());
     myMove.setSource(myLocation);
 
-    bit = LG(allMoves[pos].dest);
-    myLocation.x = COL((int)rint(bit));
-    myLocation.y = ROW((int)rint(bit));    
+    myLocation.x = COL(aMove.dest());
+    myLocation.y = ROW(aMove.dest());
     myMove.setDest(myLocation);
 
+    if (aMove.type() == MOVE_PROMOTION)
+      myMove.setPromotion(aMove.promotion());
+
     return myMove;
   }
 
+
+  //! Convert a move with x/y locations into a packed move for the current board.
+  /** Castlings, en passant captures and promotions are recognized from the pieces on the board; pawns are promoted to
+   *  the piece the move names, a queen unless it says otherwise.
+   *  @param aMove is the move as given by a player
+   *  @return The same move as a PackedMove
+   *  @see toMove()
+   */
+  PackedMove Board::toPackedMove(Move aMove) {
+    int source = aMove.source().y * 8 + aMove.source().x;
+    int dest = aMove.dest().y * 8 + aMove.dest().x;
+    int piece = curPos.square[source].getPiece();
+
+    if (piece == KING && (dest - source == 2 || dest - source == -2))
+      return PackedMove(source, dest, MOVE_CASTLING);
+    else if (piece == PAWN && (ROW(dest) == 0 || ROW(dest) == 7))
+      return PackedMove(source, dest, MOVE_PROMOTION, aMove.promotion());
+    else if (piece == PAWN && dest == curPos.epSquare && COL(dest) != COL(source))
+      return PackedMove(source, dest, MOVE_ENPASSANT);
+
+    return PackedMove(source, dest);
+  }
+
   
   //! Return the list of possible moves for the board, generated by genMoves()
   /** This method only returns something sensible if genMoves() was called to generate a valid move list.
-   *  @return A vector that contains all possible moves for the current player on the board.
+   *  @return A list that contains all possible moves for the current player on the board, valid until the next call of genMoves()
    *  @see genMoves()
    */
-  vector<BitBoardMove> Board::getMoves(void) {
+  const MoveList& Board::getMoves(void) const {
     return allMoves;
   }
   
@@ -1359,6 +1598,15 @@ namespace brd {
    *  @see getBestMove()
    */
   void Board::setBestMove(Move bMove) {
+    bestMove = toPackedMove(bMove);
+  }
+
+
+  //! Set the internal variable that stores the best move for the player, given as a packed move
+  /** @param bMove represents the best move
+   *  @see getBestMove()
+   */
+  void Board::setBestMove(PackedMove bMove) {
     bestMove = bMove;
   }
 
@@ -1369,18 +1617,18 @@ namespace brd {
    *  @return The best move for the computer player.
    */
   Move Board::getBestMove(void) {
-    return bestMove;
+    return toMove(bestMove);
   }
 
 
   //! Return the current game situation, i.e. the entire board representation
   /** This method returns the entire game situation, represented in the class Position.
    *  Agoris stores the current game in a class called Position.
-   *  @return A class that represents the game, incl. all bit boards.
+   *  @return A class that represents the game, incl. all bit boards. It is not copied and changes with the board.
    *  @see setBoard()
    *  @see Position()
    */
-   Position Board::getBoard(void) {
+  const Position& Board::getBoard(void) const {
     return curPos;
   }
 
@@ -1393,7 +1641,7 @@ namespace brd {
    *  @see getBoard()
    *  @see Position()
    */
-  void Board::setBoard(Position newPos) {
+  void Board::setBoard(const Position& newPos) {
     curPos = newPos;
   }
 
@@ -1426,6 +1674,19 @@ namespace brd {
   }
 
   
+  //! Forget the checks, promotions and protected pieces the generators have counted so far
+  /** @see getChecks()
+   *  @see getPromotions()
+   *  @see getSafetyBoard()
+   */
+  void Board::clearCounters(void) {
+    checks = 0;
+    promotions = 0;
+    for (int i = 0; i < 64; i++)
+      safetyBoard[i] = 0;
+  }
+
+  
   //! Use this function to define which side is check mate
   /** 
    *  @param aColor is used to set a certain color (WHITE, BLACK or default EMPTY) check mate
@@ -1444,6 +1705,25 @@ namespace brd {
     return checkmate;
   }
 
+
+  //! Use this function to mark that the side to move has no legal move but is not in check
+  /**
+   *  @param isStalemate is true for a stalemate, false otherwise
+   *  @see getStalemate()
+   */
+  void Board::setStalemate(bool isStalemate) {
+    stalemate = isStalemate;
+  }
+
+
+  //! Use this function to find out whether the game has ended in a stalemate
+  /**
+   *  @return True if the side to move has no legal move and is not in check
+   */
+  bool Board::getStalemate(void) {
+    return stalemate;
+  }
+
   
   //! Return the number of possible pawn promotions for the current player on the board
   /**
@@ -1459,7 +1739,7 @@ namespace brd {
    *  @return True if castling is possible, false otherwise
    */
   bool Board::isWhiteCastlingPossible(void) {
-    if (curPos.whiteCastlingWest || curPos.whiteCastlingEast)
+    if (curPos.castling & (CASTLING_WHITE_WEST | CASTLING_WHITE_EAST))
       return true;
     else
       return false;
@@ -1470,7 +1750,7 @@ namespace brd {
    *  @return True if castling is possible, false otherwise
    */
   bool Board::isBlackCastlingPossible(void) {
-    if (curPos.blackCastlingWest || curPos.blackCastlingEast)
+    if (curPos.castling & (CASTLING_BLACK_WEST | CASTLING_BLACK_EAST))
       return true;
     else
       return false;
@@ -20,14 +20,46 @@
 #define __BOARD_H_
 
 #include <vector>
+#include <string>
 extern "C" {
 #include <math.h>
 }
 #include "Square.hh"
+#include "Attacks.hh"
+#include "Zobrist.hh"
 
 #define COL(x)  (x & 7)
 #define ROW(x)  (x >> 3)
-#define LG(x)   (log(x)/log(2))
+
+// Bit boards of the a-column, the h-column and of a whole row
+#define COL_A_SQUARES   ((BitBoard)0x0101010101010101ULL)
+#define COL_H_SQUARES   ((BitBoard)0x8080808080808080ULL)
+#define ROW_SQUARES(x)  ((BitBoard)0xff << ((x) << 3))
+
+#define MAX_MOVES 256
+
+// Kinds of moves, as stored in a PackedMove
+#define MOVE_NORMAL    0
+#define MOVE_PROMOTION 1
+#define MOVE_ENPASSANT 2
+#define MOVE_CASTLING  3
+
+// Marks that no en passant capture is possible
+#define NO_SQUARE 64
+
+// Align a class to the start of a cache line
+#define CACHE_LINE_SIZE 64
+#ifdef __GNUC__
+#define CACHE_ALIGNED __attribute__ ((aligned (CACHE_LINE_SIZE)))
+#else
+#define CACHE_ALIGNED
+#endif
+
+// Castling rights, as stored in a Position
+#define CASTLING_WHITE_WEST 1
+#define CASTLING_WHITE_EAST 2
+#define CASTLING_BLACK_WEST 4
+#define CASTLING_BLACK_EAST 8
 
 #define WHITE 1
 #ifndef EMPTY
@@ -39,15 +71,50 @@ using namespace std;
 
 namespace brd {
 
-  typedef u_int64_t BitBoard;
-  
-  class BitBoardMove {
+  //! A move packed into 16 bits.
+  /** Bits 0-5 hold the source square, bits 6-11 the destination square, bits 12-13 the piece a pawn is
+   *  promoted to (counted from KNIGHT) and bits 14-15 the kind of move (MOVE_NORMAL, MOVE_PROMOTION,
+   *  MOVE_ENPASSANT or MOVE_CASTLING). This is what the move generators, makeMove() and the search work with;
+   *  Move is only used at the interface to the players.
+   */
+  class PackedMove {
+  private:
+    u_int16_t data;
+
   public:
-    BitBoard source, dest;
-    int score;
-    BitBoardMove();
+    PackedMove() {}
+    PackedMove(int from, int to, int type = MOVE_NORMAL, int promotion = KNIGHT) {
+      data = from | (to << 6) | ((promotion - KNIGHT) << 12) | (type << 14);
+    }
+    int source(void) const { return data & 63; }
+    int dest(void) const { return (data >> 6) & 63; }
+    int promotion(void) const { return ((data >> 12) & 3) + KNIGHT; }
+    int type(void) const { return data >> 14; }
+    u_int16_t getData(void) const { return data; }
+    void setData(u_int16_t newData) { data = newData; }
+    bool operator==(const PackedMove& aMove) const { return data == aMove.data; }
+    bool operator!=(const PackedMove& aMove) const { return data != aMove.data; }
   };
   
+  //! A list of moves with fixed capacity, so generating moves never allocates memory.
+  /** MAX_MOVES is more than any legal chess position allows. The list is meant to live on the stack
+   *  of the caller (or inside a Board) and moves are appended to it in place by the generators.
+   */
+  class MoveList {
+  private:
+    PackedMove moves[MAX_MOVES];
+    int count;
+
+  public:
+    MoveList() { count = 0; }
+    void push_back(PackedMove aMove) { moves[count++] = aMove; }
+    void clear(void) { count = 0; }
+    void resize(int newSize) { count = newSize; }
+    int size(void) const { return count; }
+    PackedMove& operator[](int pos) { return moves[pos]; }
+    PackedMove operator[](int pos) const { return moves[pos]; }
+  };
+
   class Location {
   public:
     int x, y;
@@ -58,33 +125,47 @@ namespace brd {
   private:
     Location from;
     Location to;
+    int promotionPiece;              // What a pawn reaching the last row becomes, QUEEN unless set otherwise
 
   public:
+    Move();
     Location source(void);
     Location dest(void);
+    int promotion(void);
     void setSource(Location);
     void setDest(Location);
+    void setPromotion(int);
   };
   
+  //! A game situation, laid out to fit into three cache lines.
+  /** The first line holds one bit board per kind of piece and one per color, the second one the piece on
+   *  every square, one byte each, and the last one everything else: the side to move, the castling rights,
+   *  the en passant square, the Zobrist hash key of the position and a second key of the pawns alone.
+   */
   class Position {
   public:
+    BitBoard pieces[6];              // Indexed by PAWN ... KING
+    BitBoard colors[2];              // Indexed by BLACK and WHITE
     Square square[64];
-    BitBoard blackPieces;
-    BitBoard blackPawns;
-    BitBoard blackRooks;
-    BitBoard blackKnights;
-    BitBoard blackBishops;
-    BitBoard blackQueens;
-    BitBoard blackKing;
-    BitBoard whitePieces;
-    BitBoard whitePawns;
-    BitBoard whiteRooks;
-    BitBoard whiteKnights;
-    BitBoard whiteBishops;
-    BitBoard whiteQueens;
-    BitBoard whiteKing;
-    bool whiteCastlingWest, whiteCastlingEast;
-    bool blackCastlingEast, blackCastlingWest;
+    u_int64_t hash;
+    u_int64_t pawnHash;
+    unsigned char side;
+    unsigned char castling;          // CASTLING_* flags
+    unsigned char epSquare;          // NO_SQUARE if there is no en passant capture
+
+    BitBoard pieceBoard(int color, int piece) const { return pieces[piece] & colors[color]; }
+    BitBoard occupied(void) const { return colors[WHITE] | colors[BLACK]; }
+  } CACHE_ALIGNED;
+
+  //! What makeMove() has to remember so undoMove() can take the move back.
+  /** Everything else follows from the move itself and the position after it.
+   */
+  class UndoInfo {
+  public:
+    PackedMove move;
+    unsigned char captured;
+    unsigned char castling;
+    unsigned char epSquare;
   };
 
   const char pieceChar[6] = { 'P', 'N', 'B', 'R', 'Q', 'K' };
@@ -111,53 +192,22 @@ namespace brd {
     3, 1, 2, 4, 5, 2, 1, 3
   };
 
-  // Move possibilities
-  const int rookPosLeft[7] =  { -1, -2, -3, -4, -5, -6, -7 };
-  const int rookPosRight[7] = { 1, 2, 3, 4, 5, 6, 7 };
-  const int rookPosDown[7] = { 8, 16, 24, 32, 40, 48, 56 };
-  const int rookPosUp[7] = { -8, -16, -24, -32, -40, -48, -56 };
-  const int knightPos[8] = { -17, -15, -6, -10, 17, 15, 6, 10 };
-  const int bishPosLUp[7] = { -9, -18, -27, -36, -45, -54, -63 };
-  const int bishPosLDown[7] = { 7, 14, 21, 28, 35, 42, 49 };
-  const int bishPosRUp[7] = { -7, -14, -21, -28, -35, -42, -49 };
-  const int bishPosRDown[7] = { 9 , 18, 27, 36, 45, 54, 63 };
-  const int kingPos[8] = { 1, -1, 8, -8, 9, -9, 7, -7 };
-   
-  const int mailbox[120] = {
-    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-    -1,  0,  1,  2,  3,  4,  5,  6,  7, -1,
-    -1,  8,  9, 10, 11, 12, 13, 14, 15, -1,
-    -1, 16, 17, 18, 19, 20, 21, 22, 23, -1,
-    -1, 24, 25, 26, 27, 28, 29, 30, 31, -1,
-    -1, 32, 33, 34, 35, 36, 37, 38, 39, -1,
-    -1, 40, 41, 42, 43, 44, 45, 46, 47, -1,
-    -1, 48, 49, 50, 51, 52, 53, 54, 55, -1,
-    -1, 56, 57, 58, 59, 60, 61, 62, 63, -1,
-    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
-  };
-  
-  const int mailbox64[64] = {
-    21, 22, 23, 24, 25, 26, 27, 28,
-    31, 32, 33, 34, 35, 36, 37, 38,
-    41, 42, 43, 44, 45, 46, 47, 48,
-    51, 52, 53, 54, 55, 56, 57, 58,
-    61, 62, 63, 64, 65, 66, 67, 68,
-    71, 72, 73, 74, 75, 76, 77, 78,
-    81, 82, 83, 84, 85, 86, 87, 88,
-    91, 92, 93, 94, 95, 96, 97, 98
-  };
-  
+  // Declare the member template behind a public member that looks up slider attacks, and the member that runs its
+  // PEXT instance
+#ifdef HAVE_PEXT
+#define BACKEND_INSTANCES(type, name, params) template<int> type name params; PEXT_INSTANCE type name##Pext params
+#else
+#define BACKEND_INSTANCES(type, name, params) template<int> type name params
+#endif
+
   class Board {
   private:
-    int checkmate;
-    unsigned int curTurn;
-    BitBoard mask[64];
-    Move bestMove;
-    vector<BitBoardMove> allMoves;
     Position curPos;
-    vector<Position> history;
+    int checkmate;
+    bool stalemate;
+    PackedMove bestMove;
+    MoveList allMoves;
+    vector<UndoInfo> history;
     int safetyBoard[64];
     int checks;
     int promotions;
@@ -171,50 +221,115 @@ namespace brd {
     double infVal;
 
   protected:
-    bool outOfBoundary(int, int);
     bool possiblePawnMove(int, int);
-    bool possiblePawnCapture(int, int);
+    void addMoves(MoveList&, int, BitBoard);
+    void addCaptures(MoveList&, int, BitBoard);
+    void addPawnMove(MoveList&, int, int);
+    void addPawnMoves(MoveList&, BitBoard, int);
+    void putPiece(int, int, int);
+    void removePiece(int);
+    void checkHash(void);
+
+    // What the public members of the same name run, for one slider attack backend each (see Attacks.hh)
+    BACKEND_INSTANCES(BitBoard, attackersTo, (int, BitBoard));
+    BACKEND_INSTANCES(bool, isAttacked, (int, int));
+    BACKEND_INSTANCES(double, see, (PackedMove));
+    BACKEND_INSTANCES(BitBoard, pinnedPieces, (int));
+    BACKEND_INSTANCES(BitBoard, checkMask, (void));
+    BACKEND_INSTANCES(bool, isLegal, (PackedMove, BitBoard, BitBoard));
+    BACKEND_INSTANCES(bool, isPseudoLegal, (PackedMove));
+    BACKEND_INSTANCES(void, genMoves, (MoveList&));
+    BACKEND_INSTANCES(void, genLegalMoves, (MoveList&));
+    BACKEND_INSTANCES(void, genCaptures, (MoveList&));
+    BACKEND_INSTANCES(void, genQuiets, (MoveList&));
+    BACKEND_INSTANCES(void, genRookMoves, (int, MoveList&));
+    BACKEND_INSTANCES(void, genRookCaptures, (int, MoveList&));
+    BACKEND_INSTANCES(void, genBishopMoves, (int, MoveList&));
+    BACKEND_INSTANCES(void, genBishopCaptures, (int, MoveList&));
+    BACKEND_INSTANCES(void, genQueenMoves, (int, MoveList&));
+    BACKEND_INSTANCES(void, genQueenCaptures, (int, MoveList&));
+    BACKEND_INSTANCES(void, genCastlingMoves, (int, MoveList&));
     
   public:
     Board();
     void genMoves(void);
-    vector<BitBoardMove> genPawnMoves(int);
-    vector<BitBoardMove> genPawnCaptures(int);
-    vector<BitBoardMove> genRookMoves(int);
-    vector<BitBoardMove> genRookCaptures(int);
-    vector<BitBoardMove> genKnightMoves(int);
-    vector<BitBoardMove> genKnightCaptures(int);
-    vector<BitBoardMove> genBishopMoves(int);
-    vector<BitBoardMove> genBishopCaptures(int);
-    vector<BitBoardMove> genQueenMoves(int);
-    vector<BitBoardMove> genQueenCaptures(int);
-    vector<BitBoardMove> genKingMoves(int);
-    vector<BitBoardMove> genKingCaptures(int);
-    vector<BitBoardMove> genCastlingMoves(int);
+    void genMoves(MoveList&);
+    void genLegalMoves(MoveList&);
+    void genCaptures(MoveList&);
+    void genQuiets(MoveList&);
+    BitBoard pinnedPieces(int);
+    BitBoard checkMask(void);
+    bool isLegal(PackedMove, BitBoard, BitBoard);
+    bool isPseudoLegal(PackedMove);
+    bool isQuiet(PackedMove);
+    BitBoard attackersTo(int, BitBoard);
+    BitBoard attackersTo(int);
+    bool isAttacked(int, int);
+    bool isInCheck(void);
+    double see(PackedMove);
+    void genPawnMoves(int, MoveList&);
+    void genPawnCaptures(int, MoveList&);
+    void genPawnPushes(MoveList&, BitBoard);
+    void genPawnCaptures(MoveList&);
+    BitBoard pawnPushes(int);
+    BitBoard pawnAttacksWest(int);
+    BitBoard pawnAttacksEast(int);
+    BitBoard pawnAttackSpan(int);
+    int pawnPromotions(int);
+    void genRookMoves(int, MoveList&);
+    void genRookCaptures(int, MoveList&);
+    void genKnightMoves(int, MoveList&);
+    void genKnightCaptures(int, MoveList&);
+    void genBishopMoves(int, MoveList&);
+    void genBishopCaptures(int, MoveList&);
+    void genQueenMoves(int, MoveList&);
+    void genQueenCaptures(int, MoveList&);
+    void genKingMoves(int, MoveList&);
+    void genKingCaptures(int, MoveList&);
+    void genCastlingMoves(int, MoveList&);
     void makeMove(Move);
+    void makeMove(PackedMove);
     bool isValidMove(Move);
-    bool isCheckSituation(Move);
+    bool isValidMove(PackedMove);
+    bool isCheckSituation(PackedMove);
     void undoMove(void);
-    vector<BitBoardMove> getMoves(void);
+    void makeNullMove(void);
+    void undoNullMove(void);
+    bool hasPieces(int);
+    const MoveList& getMoves(void) const;
     void doArrayMove(int);
     Move getArrayMove(int);
+    Move toMove(PackedMove);
+    PackedMove toPackedMove(Move);
     void setBestMove(Move);
+    void setBestMove(PackedMove);
     Move getBestMove(void);
     void nextTurn(void);
     int getTurn(void);
     void setTurn(int);
-    Position getBoard(void);
-    void setBoard(Position);
+    const Position& getBoard(void) const;
+    void setBoard(const Position&);
     int* getSafetyBoard(void);
     int getChecks(void);
+    void clearCounters(void);
     void setCheckmate(int);
     int getCheckmate(void);
+    void setStalemate(bool);
+    bool getStalemate(void);
     int getPromotions(void);
     bool isBlackCastlingPossible(void);
     bool isWhiteCastlingPossible(void);
     void setPieceValue(int, double);
     double getPieceValue(int);
     void printBitBoard(BitBoard);
+    u_int64_t getHash(void);
+    u_int64_t getPawnHash(void);
+    u_int64_t computeHash(void);
+    u_int64_t computePawnHash(void);
+    u_int64_t perft(int);
+    u_int64_t perftDivide(int);
+    bool setFen(string);
+    string moveToString(PackedMove);
   };
   
 }
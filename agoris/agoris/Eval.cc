@@ -17,6 +17,7 @@
 // USA.
 
 
+#include <iostream>
 #include <vector>
 #include "Eval.hh"
 #include "Board.hh"
@@ -27,71 +28,86 @@ extern "C" {
 
 using namespace std;
 
-//! Standard constructor
-Eval::Eval() {
-  brd::BitBoard bit = 1;
- 
-  for (unsigned long i = 0; i < 64; i++)
-    mask[i] = bit << i;
+//! Evaluate current board situation for current player
+/** This method returns a score associated with the board situation. Both sides are scored the same way, and the
+ *  score of the opponent is subtracted from that of the side to move, so the score of a position seen from one
+ *  side is always minus the score seen from the other.
+ *  @param aBoard is a pointer to the current chess board
+ *  @return The score associated with the current game situation, seen from the current player's viewpoint
+ *  @see genSideScore()
+ */
+double Eval::doEval(brd::Board* aBoard) {
+  int side = aBoard->getTurn();
+  double curScore = genSideScore(aBoard);
+
+  // The opponent's pieces are only generated as the side to move
+  aBoard->setTurn(side == WHITE ? BLACK : WHITE);
+  curScore -= genSideScore(aBoard);
+  aBoard->setTurn(side);
+
+  return curScore;
 }
 
 
-//! Evaluate current board situation for current player
-/** This method returns a score associated with the board situation.
- *  It considers material values, piece safety, check possibilities, etc.
+//! Score the pieces of the side to move on their own
+/** This method considers material values, piece safety, check possibilities, etc. of the side to move only.
  *  @param aBoard is a pointer to the current chess board
- *  @return The score associated with the current game situation, seen from the current player's viewpoint
+ *  @return The score of the side to move, without looking at the score of the opponent
  *  @see genMaterialScore()
  *  @see genPieceSafetyScore()
  *  @see genChecksScore()
  *  @see genPromotionsScore()
  *  @see genCastlingScore()
+ *  @see genKingSafetyScore()
  */
-double Eval::doEval(brd::Board* aBoard) {
+double Eval::genSideScore(brd::Board* aBoard) {
   double curScore = 0;
-  brd::Position curPos = aBoard->getBoard();
+  const brd::Position& curPos = aBoard->getBoard();
+
+  // The checks, promotions and piece safety below are those the generators count for this side alone
+  aBoard->clearCounters();
 
   // Mobility
-  for (int i = 0; i < 64; i++) {
-    if ((int)curPos.square[i].getColor() == aBoard->getTurn()) {
-      switch (curPos.square[i].getPiece()) {
-      case PAWN:
-	curScore += genPawnScore(aBoard, i);
+  for (brd::BitBoard own = curPos.colors[aBoard->getTurn()]; own; ) {
+    int i = brd::popFirstBit(own);
+
+    switch (curPos.square[i].getPiece()) {
+    case PAWN:
+      curScore += genPawnScore(aBoard, i);
 #ifdef DEBUG
   cout << "Pawn Mob.: " << curScore << endl;
 #endif
-	break;
-      case ROOK:
-	curScore += genRookScore(aBoard, i);
+      break;
+    case ROOK:
+      curScore += genRookScore(aBoard, i);
 #ifdef DEBUG
   cout << "Rook Mob.: " << curScore << endl;
 #endif
-	break;
-      case KNIGHT:
-	curScore += genKnightScore(aBoard, i);
+      break;
+    case KNIGHT:
+      curScore += genKnightScore(aBoard, i);
 #ifdef DEBUG
   cout << "Knight Mob.: " << curScore << endl;
 #endif
-	break;
-      case BISHOP:
-	curScore += genBishopScore(aBoard, i);
+      break;
+    case BISHOP:
+      curScore += genBishopScore(aBoard, i);
 #ifdef DEBUG
   cout << "Bishop Mob.: " << curScore << endl;
 #endif
-	break;
-      case QUEEN:
-	curScore += genQueenScore(aBoard, i);
+      break;
+    case QUEEN:
+      curScore += genQueenScore(aBoard, i);
 #ifdef DEBUG
   cout << "Queen Mob.: " << curScore << endl;
 #endif
-	break;
-      case KING:
-	curScore += genKingScore(aBoard, i);
+      break;
+    case KING:
+      curScore += genKingScore(aBoard, i);
 #ifdef DEBUG
   cout << "King Mob.: " << curScore << endl;
 #endif
-	break;
-      }
+      break;
     }
   }
 
@@ -123,6 +139,12 @@ double Eval::doEval(brd::Board* aBoard) {
   curScore += genCastlingScore(aBoard);
 #ifdef DEBUG
   cout << "Castling: " << curScore << endl;
+#endif
+
+  // King safety
+  curScore += genKingSafetyScore(aBoard);
+#ifdef DEBUG
+  cout << "King safety: " << curScore << endl;
   cout << endl;
 #endif
 
@@ -138,32 +160,10 @@ double Eval::doEval(brd::Board* aBoard) {
  */
 double Eval::genMaterialScore(brd::Board *aBoard) {
   double curScore = 0;
-  brd::Position curPos = aBoard->getBoard();
+  const brd::Position& curPos = aBoard->getBoard();
 
-  for (int i = 0; i < 64; i++) {
-    if ((int)curPos.square[i].getColor() == aBoard->getTurn()) {
-      switch (curPos.square[i].getPiece()) {
-      case PAWN:
-	curScore += aBoard->getPieceValue(PAWN);
-	break;
-      case ROOK:
-	curScore += aBoard->getPieceValue(ROOK);
-	break;
-      case KNIGHT:
-	curScore += aBoard->getPieceValue(KNIGHT);
-	break;
-      case BISHOP:
-	curScore += aBoard->getPieceValue(BISHOP);
-	break;
-      case QUEEN:
-	curScore += aBoard->getPieceValue(QUEEN);
-	break;
-      case KING:
-	curScore += aBoard->getPieceValue(KING);
-	break;
-      }
-    }
-  }
+  for (int piece = PAWN; piece <= KING; piece++)
+    curScore += brd::popCount(curPos.pieceBoard(aBoard->getTurn(), piece)) * aBoard->getPieceValue(piece);
 
   return curScore;
 }
@@ -184,6 +184,31 @@ double Eval::genCastlingScore(brd::Board *aBoard) {
 }
 
 
+//! Generate score for the safety of the own king
+/** This method returns a negative score for every square around the own king that is attacked by the opponent,
+ *  and for the king being in check.
+ *  @param aBoard is a pointer to the current chess board
+ *  @return Returns -0.5 for every attacked square next to the king, -1 more if the king is in check
+ */
+double Eval::genKingSafetyScore(brd::Board *aBoard) {
+  int them = aBoard->getTurn() == WHITE ? BLACK : WHITE;
+  brd::BitBoard king = aBoard->getBoard().pieceBoard(aBoard->getTurn(), KING);
+  double score = 0;
+
+  if (!king)
+    return 0;
+
+  for (brd::BitBoard zone = brd::kingAttacks[brd::firstBit(king)]; zone; zone &= zone - 1)
+    if (aBoard->isAttacked(brd::firstBit(zone), them))
+      score -= 0.5;
+
+  if (aBoard->isInCheck())
+    score -= 1;
+
+  return score;
+}
+
+
 //! Generate score for pawn promotions
 /** This method returns a positive score if promotions are possible.
  *  @param aBoard is a pointer to the current chess board
@@ -229,27 +254,19 @@ double Eval::genPieceSafetyScore(brd::Board *aBoard) {
 
 double Eval::genPawnScore(brd::Board *aBoard, int pawnPos) {
   double curScore = 0;
-  vector<brd::BitBoardMove> pawnMoves;
-  vector<brd::BitBoardMove> pawnCaps;
+  brd::MoveList pawnMoves;
+  brd::MoveList pawnCaps;
 
   // Mobility
-  pawnMoves = aBoard->genPawnMoves(pawnPos);
-  pawnCaps = aBoard->genPawnCaptures(pawnPos);
+  aBoard->genPawnMoves(pawnPos, pawnMoves);
+  aBoard->genPawnCaptures(pawnPos, pawnCaps);
   curScore += sqrt(pawnMoves.size() + pawnCaps.size() * 2);
 
-  // Pawn credit
-  if (aBoard->getTurn() == WHITE) {
-    for (int i = 0; i < 64; i++) {
-      if ( ((aBoard->getBoard()).whitePawns & mask[i]) && (i < 48) )
-	curScore += 0.3;
-    }
-  }
-  else {
-    for (int i = 0; i < 64; i++) {
-      if ( ((aBoard->getBoard()).blackPawns & mask[i]) && (i > 15) )
-	curScore += 0.3;
-    }
-  }
+  // Pawn credit, for every own pawn that has left its starting row
+  if (aBoard->getTurn() == WHITE)
+    curScore += 0.3 * brd::popCount(aBoard->getBoard().pieceBoard(WHITE, PAWN) & ~(brd::BitBoard)0xffff000000000000ULL);
+  else
+    curScore += 0.3 * brd::popCount(aBoard->getBoard().pieceBoard(BLACK, PAWN) & ~(brd::BitBoard)0xffffULL);
 
   return curScore;
 }
@@ -257,12 +274,12 @@ double Eval::genPawnScore(brd::Board *aBoard, int pawnPos) {
 
 double Eval::genKnightScore(brd::Board *aBoard, int knightPos) {
   double curScore = 0;
-  vector<brd::BitBoardMove> knightMoves;
-  vector<brd::BitBoardMove> knightCaps;
+  brd::MoveList knightMoves;
+  brd::MoveList knightCaps;
 
   // Mobility
-  knightMoves = aBoard->genKnightMoves(knightPos);
-  knightCaps = aBoard->genKnightCaptures(knightPos);
+  aBoard->genKnightMoves(knightPos, knightMoves);
+  aBoard->genKnightCaptures(knightPos, knightCaps);
   curScore += sqrt(knightMoves.size() + knightCaps.size() * 2);
 
   return curScore;
@@ -271,12 +288,12 @@ double Eval::genKnightScore(brd::Board *aBoard, int knightPos) {
 
 double Eval::genBishopScore(brd::Board *aBoard, int bishPos) {
   double curScore = 0;
-  vector<brd::BitBoardMove> bishMoves;
-  vector<brd::BitBoardMove> bishCaps;
+  brd::MoveList bishMoves;
+  brd::MoveList bishCaps;
 
   // Mobility
-  bishMoves = aBoard->genBishopMoves(bishPos);
-  bishCaps = aBoard->genBishopCaptures(bishPos);
+  aBoard->genBishopMoves(bishPos, bishMoves);
+  aBoard->genBishopCaptures(bishPos, bishCaps);
   curScore += sqrt(bishMoves.size() + bishCaps.size() * 2);
 
   return curScore;
@@ -285,12 +302,12 @@ double Eval::genBishopScore(brd::Board *aBoard, int bishPos) {
 
 double Eval::genRookScore(brd::Board *aBoard, int rookPos) {
   double curScore = 0;
-  vector<brd::BitBoardMove> rookMoves;
-  vector<brd::BitBoardMove> rookCaps;
+  brd::MoveList rookMoves;
+  brd::MoveList rookCaps;
 
   // Mobility
-  rookMoves = aBoard->genRookMoves(rookPos);
-  rookCaps = aBoard->genRookCaptures(rookPos);
+  aBoard->genRookMoves(rookPos, rookMoves);
+  aBoard->genRookCaptures(rookPos, rookCaps);
   curScore += sqrt(rookMoves.size() + rookCaps.size() * 2);
 
   return curScore;
@@ -299,12 +316,12 @@ double Eval::genRookScore(brd::Board *aBoard, int rookPos) {
 
 double Eval::genQueenScore(brd::Board *aBoard, int queenPos) {
   double curScore = 0;
-  vector<brd::BitBoardMove> queenMoves;
-  vector<brd::BitBoardMove> queenCaps;
+  brd::MoveList queenMoves;
+  brd::MoveList queenCaps;
 
   // Mobility
-  queenMoves = aBoard->genQueenMoves(queenPos);
-  queenCaps = aBoard->genQueenCaptures(queenPos);
+  aBoard->genQueenMoves(queenPos, queenMoves);
+  aBoard->genQueenCaptures(queenPos, queenCaps);
   curScore += sqrt(queenMoves.size() + queenCaps.size() * 2);
 
   return curScore;
@@ -313,12 +330,12 @@ double Eval::genQueenScore(brd::Board *aBoard, int queenPos) {
 
 double Eval::genKingScore(brd::Board *aBoard, int kingPos) {
   double curScore = 0;
-  vector<brd::BitBoardMove> kingMoves;
-  vector<brd::BitBoardMove> kingCaps;
+  brd::MoveList kingMoves;
+  brd::MoveList kingCaps;
 
   // Mobility
-  kingMoves = aBoard->genKingMoves(kingPos);
-  kingCaps = aBoard->genKingCaptures(kingPos);
+  aBoard->genKingMoves(kingPos, kingMoves);
+  aBoard->genKingCaptures(kingPos, kingCaps);
   curScore += sqrt(kingMoves.size() + kingCaps.size() * 2);
 
   return curScore;
@@ -23,10 +23,11 @@
 
 class Eval {
 private:
-  brd::BitBoard mask[64];
+  double genSideScore(brd::Board*);
   double genChecksScore(brd::Board*);
   double genPromotionsScore(brd::Board*);
   double genCastlingScore(brd::Board*);
+  double genKingSafetyScore(brd::Board*);
   double genMaterialScore(brd::Board*);
   double genPieceSafetyScore(brd::Board*);
   double genPawnScore(brd::Board*, int);
@@ -37,7 +38,6 @@ private:
   double genKingScore(brd::Board*, int);
 
 public:
-  Eval();
   double doEval(brd::Board*);
 };
 
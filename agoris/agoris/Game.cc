@@ -16,16 +16,21 @@
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
 // USA.
 
+#include <iostream>
 #include "Game.hh"
 #include "Board.hh"
 #include "Square.hh"
 #include "Search.hh"
 #include "Eval.hh"
+#include "TransTable.hh"
+
+using namespace std;
 
 
 Game::Game() {
   humanColor = true;
   boardSearch.setBoard(&theBoard);
+  boardSearch.setTransTable(&hashTable);
 }
 
 
@@ -57,9 +62,11 @@ bool Game::isValidMove(brd::Move newMove) {
     tempBoard.setTurn(WHITE);
     tempBoard.genMoves();
 
-    for (unsigned int i = 0; i < tempBoard.getMoves().size(); i++)
-      if (tempBoard.getArrayMove(i).source().x == newMove.source().x && tempBoard.getArrayMove(i).source().y == newMove.source().y &&
-	  tempBoard.getArrayMove(i).dest().x == newMove.dest().x && tempBoard.getArrayMove(i).dest().y == newMove.dest().y )
+    const brd::MoveList& moves = tempBoard.getMoves();
+    brd::PackedMove aMove = theBoard.toPackedMove(newMove);
+
+    for (int i = 0; i < moves.size(); i++)
+      if (moves[i] == aMove)
 	return true;
   }    
   
@@ -70,12 +77,18 @@ bool Game::isValidMove(brd::Move newMove) {
 //! Calculate best possible move with a given search depth and a given algorithm
 /** This function generates the best move for the computer player.
  *  It lets you choose the algorithm to use and also what search depth to use.
- *  @param algorithm 0 if minimax algorithm is prefered, 1 for alpha-beta pruning
+ *  @param algorithm 0 if minimax algorithm is prefered, 1 for alpha-beta pruning with iterative deepening
  *  @param depth is the search depth
  *  @return The best possible move for the computer player
  */
 brd::Move Game::calculateMove(int algorithm, int depth = 3) {
   boardSearch.initTimer();
+  boardSearch.clearKillers();
+  boardSearch.clearHistory();
+  hashTable.newSearch();
+  theBoard.setCheckmate(EMPTY);
+  theBoard.setStalemate(false);
+  theBoard.setBestMove(brd::PackedMove(0, 0));
 
   if (algorithm == 0) {
 #ifdef DEBUG
@@ -88,7 +101,7 @@ brd::Move Game::calculateMove(int algorithm, int depth = 3) {
       ;
   }
   else
-    boardSearch.alphaBeta(&theBoard, -(theBoard.getPieceValue(INFINITY)), theBoard.getPieceValue(INFINITY), depth);
+    boardSearch.iterativeDeepening(&theBoard, depth);
 
   return theBoard.getBestMove();
 }
@@ -105,7 +118,31 @@ void Game::setMaxTime(double time) {
 }
 
 
-brd::Position Game::getBoard(void) {
+//! Set the size of the transposition table used by the search, which also clears it
+/** @param megabytes is the new size in megabytes
+ */
+void Game::setHashSize(int megabytes) {
+  hashTable.setSize(megabytes);
+}
+
+
+//! Set the number of threads the computer thinks with
+/** @param count is the number of threads, 1 for a search without helper threads
+ */
+void Game::setThreads(int count) {
+  boardSearch.setThreads(count);
+}
+
+
+//! Choose how the threads search together
+/** @param mode is PARALLEL_LAZY (the default) or PARALLEL_YBWC
+ */
+void Game::setParallelMode(int mode) {
+  boardSearch.setParallelMode(mode);
+}
+
+
+const brd::Position& Game::getBoard(void) {
   return theBoard.getBoard();
 }
 
@@ -120,6 +157,12 @@ int Game::getCheckmate(void) {
 }
 
 
+//! Return true if the computer found no legal move without being in check, the game is then drawn
+bool Game::getStalemate(void) {
+  return theBoard.getStalemate();
+}
+
+
 void Game::setPawnValue(double val = 1) {
   theBoard.setPieceValue(PAWN, val);
 }
@@ -21,6 +21,7 @@
 
 #include "Board.hh"
 #include "Search.hh"
+#include "TransTable.hh"
 
 using namespace brd;
 
@@ -28,6 +29,7 @@ class Game {
 private:
   brd::Board theBoard;
   Search boardSearch;
+  TransTable hashTable;
   bool humanColor;
 
 public:
@@ -39,10 +41,14 @@ public:
   void makeMove(Move);
   Move calculateMove(int, int depth = 3);
   double eval(void);
-  Position getBoard(void);
+  const Position& getBoard(void);
   Move getBestMove(void);
   int getCheckmate(void);
+  bool getStalemate(void);
   void setMaxTime(double);
+  void setHashSize(int);
+  void setThreads(int);
+  void setParallelMode(int);
 
   void setPawnValue(double val = 1);
   void setKnightValue(double val = 3);
@@ -0,0 +1,201 @@
+// MovePicker.cc - source file for the Agoris program
+// Copyright (c) 2001  Andreas Bauer <baueran@in.tum.de>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+// USA.
+
+#include "MovePicker.hh"
+#include "Board.hh"
+
+
+//! Prepare to pick the moves of the side to move on aBoard.
+/** @param aBoard is the position, which must not change while moves are picked
+ *  @param newHashMove is the move from the transposition table, PackedMove(0, 0) if there is none
+ *  @param killer1 is the first killer move of this ply, PackedMove(0, 0) if there is none
+ *  @param killer2 is the second killer move of this ply, PackedMove(0, 0) if there is none
+ *  @param newHistory is how often each move, indexed by source and destination, caused a cut off; 0 leaves the
+ *  quiet moves in the order they are generated
+ */
+MovePicker::MovePicker(brd::Board* aBoard, brd::PackedMove newHashMove, brd::PackedMove killer1, brd::PackedMove killer2,
+		       const int (*newHistory)[64]) {
+  board = aBoard;
+  hashMove = newHashMove;
+  killers[0] = killer1;
+  killers[1] = killer2;
+  history = newHistory;
+  pinned = board->pinnedPieces(board->getTurn());
+  evasions = board->checkMask();
+  stage = STAGE_HASH_MOVE;
+  current = 0;
+  capturesOnly = false;
+}
+
+
+//! Prepare to pick only the captures and promotions of the side to move that do not lose material.
+/** Losing captures, as found by the static exchange evaluation, are left out altogether.
+ *  @param aBoard is the position, which must not change while moves are picked
+ */
+MovePicker::MovePicker(brd::Board* aBoard) {
+  board = aBoard;
+  hashMove = killers[0] = killers[1] = brd::PackedMove(0, 0);
+  history = 0;
+  pinned = board->pinnedPieces(board->getTurn());
+  evasions = board->checkMask();
+  stage = STAGE_GEN_CAPTURES;
+  current = 0;
+  capturesOnly = true;
+}
+
+
+//! Order the quiet moves not scored yet by another history table.
+/** @param newHistory is how often each move, indexed by source and destination, caused a cut off
+ */
+void MovePicker::setHistory(const int (*newHistory)[64]) {
+  history = newHistory;
+}
+
+
+//! Check whether a move that was not generated in this position can be played here.
+bool MovePicker::isUsable(brd::PackedMove aMove) {
+  return aMove != brd::PackedMove(0, 0) && board->isPseudoLegal(aMove) && board->isLegal(aMove, pinned, evasions);
+}
+
+
+//! Score the captures and promotions in moves by the value of the victim and of the attacker.
+/** Promotions count as capturing the piece the pawn is promoted to, so a queen promotion comes early.
+ */
+void MovePicker::scoreCaptures(void) {
+  const brd::Position& pos = board->getBoard();
+
+  for (int i = 0; i < moves.size(); i++) {
+    int victim = pos.square[moves[i].dest()].getPiece();
+
+    if (moves[i].type() == MOVE_ENPASSANT)
+      victim = PAWN;
+    scores[i] = (victim == EMPTY ? 0 : 8 * (victim + 1)) + KING - pos.square[moves[i].source()].getPiece();
+    if (moves[i].type() == MOVE_PROMOTION)
+      scores[i] += 8 * moves[i].promotion();
+  }
+}
+
+
+//! Score the quiet moves in moves by the history table.
+void MovePicker::scoreQuiets(void) {
+  for (int i = 0; i < moves.size(); i++)
+    scores[i] = history ? history[moves[i].source()][moves[i].dest()] : 0;
+}
+
+
+//! Return the best scored move not yet returned and move it out of the way.
+/** This is one step of a selection sort, so a node that is cut off early never sorts the whole list.
+ */
+brd::PackedMove MovePicker::pickBest(void) {
+  int best = current;
+  brd::PackedMove aMove;
+
+  for (int i = current + 1; i < moves.size(); i++)
+    if (scores[i] > scores[best])
+      best = i;
+
+  aMove = moves[best];
+  moves[best] = moves[current];
+  scores[best] = scores[current];
+  moves[current++] = aMove;
+
+  return aMove;
+}
+
+
+//! Return the next legal move.
+/** @param aMove is set to the next move
+ *  @return false if there are no moves left
+ */
+bool MovePicker::nextMove(brd::PackedMove& aMove) {
+  while (true) {
+    switch (stage) {
+    case STAGE_HASH_MOVE:
+      stage++;
+      if (isUsable(hashMove)) {
+	aMove = hashMove;
+	return true;
+      }
+      break;
+
+    case STAGE_GEN_CAPTURES:
+      board->genCaptures(moves);
+      scoreCaptures();
+      current = 0;
+      stage++;
+      break;
+
+    case STAGE_GOOD_CAPTURES:
+      while (current < moves.size()) {
+	aMove = pickBest();
+	if (aMove == hashMove || !board->isLegal(aMove, pinned, evasions))
+	  continue;
+
+	// Captures that lose material wait until all quiet moves have been tried
+	if (aMove.type() != MOVE_PROMOTION && board->see(aMove) < 0) {
+	  if (!capturesOnly)
+	    badCaptures.push_back(aMove);
+	  continue;
+	}
+	return true;
+      }
+      current = 0;
+      stage = capturesOnly ? STAGE_DONE : stage + 1;
+      break;
+
+    case STAGE_KILLERS:
+      while (current < 2) {
+	aMove = killers[current++];
+	if (aMove != hashMove && (current == 1 || aMove != killers[0]) &&
+	    isUsable(aMove) && board->isQuiet(aMove))
+	  return true;
+      }
+      stage++;
+      break;
+
+    case STAGE_GEN_QUIETS:
+      board->genQuiets(moves);
+      scoreQuiets();
+      current = 0;
+      stage++;
+      break;
+
+    case STAGE_QUIETS:
+      while (current < moves.size()) {
+	aMove = pickBest();
+	if (aMove != hashMove && aMove != killers[0] && aMove != killers[1] &&
+	    board->isLegal(aMove, pinned, evasions))
+	  return true;
+      }
+      current = 0;
+      stage++;
+      break;
+
+    case STAGE_BAD_CAPTURES:
+      if (current < badCaptures.size()) {
+	aMove = badCaptures[current++];
+	return true;
+      }
+      stage++;
+      break;
+
+    default:
+      return false;
+    }
+  }
+}
@@ -0,0 +1,70 @@
+// MovePicker.hh - source file for the Agoris program
+// Copyright (c) 2001  Andreas Bauer <baueran@in.tum.de>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+// USA.
+
+#ifndef _MOVEPICKER_HH_
+#define _MOVEPICKER_HH_
+
+#include "Board.hh"
+
+// The stages a MovePicker goes through, in this order
+#define STAGE_HASH_MOVE     0
+#define STAGE_GEN_CAPTURES  1
+#define STAGE_GOOD_CAPTURES 2
+#define STAGE_KILLERS       3
+#define STAGE_GEN_QUIETS    4
+#define STAGE_QUIETS        5
+#define STAGE_BAD_CAPTURES  6
+#define STAGE_DONE          7
+
+//! Hands out the legal moves of a position one at a time, best guesses first.
+/** The move from the transposition table comes first, then the captures and promotions that do not lose
+ *  material, the two killer moves, the remaining quiet moves and at last the captures that lose material.
+ *  Each group of moves is only generated once the previous one has been used up, so a node that is cut off
+ *  early never generates its quiet moves. Captures are tried most valuable victim first, least valuable
+ *  attacker first among those (MVV-LVA), quiet moves in the order of the history table.
+ *  For the quiescence search a picker can be limited to the captures and promotions that do not lose material.
+ */
+class MovePicker {
+private:
+  brd::Board* board;
+  brd::PackedMove hashMove;
+  brd::PackedMove killers[2];
+  brd::MoveList moves;
+  int scores[MAX_MOVES];
+  const int (*history)[64];
+  brd::MoveList badCaptures;
+  brd::BitBoard pinned;
+  brd::BitBoard evasions;
+  int stage;
+  int current;
+  bool capturesOnly;
+
+protected:
+  bool isUsable(brd::PackedMove);
+  void scoreCaptures(void);
+  void scoreQuiets(void);
+  brd::PackedMove pickBest(void);
+
+public:
+  MovePicker(brd::Board*);
+  MovePicker(brd::Board*, brd::PackedMove, brd::PackedMove, brd::PackedMove, const int (*)[64] = 0);
+  void setHistory(const int (*)[64]);
+  bool nextMove(brd::PackedMove&);
+};
+
+#endif
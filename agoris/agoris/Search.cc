@@ -18,19 +18,82 @@
 
 #include <iostream>
 #include <string>
+#include <new>
+extern "C" {
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <pthread.h>
+}
 #include "Search.hh"
 #include "Board.hh"
 #include "Eval.hh"
+#include "TransTable.hh"
+#include "MovePicker.hh"
+
+
+// How many plies late quiet moves are searched less deep, by remaining depth and number of the move
+static int lmrReductions[64][64];
+
+//! Fill the table of late move reductions, which grow with the logarithms of depth and move number.
+static void initReductions(void) {
+  for (int depth = 0; depth < 64; depth++)
+    for (int move = 0; move < 64; move++)
+      lmrReductions[depth][move] = depth && move ? (int)(0.5 + log((double)depth) * log((double)move) / 2) : 0;
+}
+
+// Make sure the table is ready before the first search
+static class ReductionsInit {
+public:
+  ReductionsInit() { initReductions(); }
+} reductionsInit;
 
 
 Search::Search() {
+  theBoard = 0;
+  hashTable = 0;
+  ply = 0;
+  nodes = 0;
+  qnodes = 0;
   maxTime = 60;  // 1 minute
-  minDepth = 3;  // If search depth is 9, then a minDepth of 3 would allow 7 iterations altogether
+  minDepth = 3;  // Iterations up to this depth are always completed, however long they take
+  useTimer = true;
+  stopped = false;
+  afterNullMove = false;
+  rootPVLength = 0;
+  threads = 1;
+  depthOffset = 0;
+  abortSearch = 0;
+  parallelMode = PARALLEL_LAZY;
+  pool = 0;
+  workerId = 0;
+  activeSplit = 0;
+  clearKillers();
+  clearHistory();
 }
 
 
 Search::Search(brd::Board* newBoard) {
   theBoard = newBoard;
+  hashTable = 0;
+  ply = 0;
+  nodes = 0;
+  qnodes = 0;
+  maxTime = 60;
+  minDepth = 3;
+  useTimer = true;
+  stopped = false;
+  afterNullMove = false;
+  rootPVLength = 0;
+  threads = 1;
+  depthOffset = 0;
+  abortSearch = 0;
+  parallelMode = PARALLEL_LAZY;
+  pool = 0;
+  workerId = 0;
+  activeSplit = 0;
+  clearKillers();
+  clearHistory();
 }
 
 
@@ -39,40 +102,153 @@ void Search::setBoard(brd::Board* newBoard) {
 }
 
 
+//! Use a transposition table in alphaBeta(), or none if newTable is 0
+void Search::setTransTable(TransTable* newTable) {
+  hashTable = newTable;
+}
+
+
 void Search::initTimer(void) {
   clock.resetTimer();
 }
 
 
+//! Return the number of nodes visited by alphaBeta() or miniMax() since the counter was last reset
+long Search::getNodes(void) {
+  return nodes;
+}
+
+
+//! Return the number of nodes visited by quiesce() since the counter was last reset
+long Search::getQNodes(void) {
+  return qnodes;
+}
+
+
+void Search::resetNodes(void) {
+  nodes = 0;
+  qnodes = 0;
+}
+
+
+//! Forget the killer moves of all plies
+void Search::clearKillers(void) {
+  for (int i = 0; i < MAX_PLY; i++)
+    killers[i][0] = killers[i][1] = brd::PackedMove(0, 0);
+}
+
+
+//! Reward a quiet move that caused a cut off, the more the deeper the search below it was.
+void Search::updateHistory(int side, brd::PackedMove aMove, int depth) {
+  int& entry = history[side][aMove.source()][aMove.dest()];
+
+  entry += depth * depth;
+
+  // Keep the table from overflowing and let old results fade
+  if (entry > MAX_HISTORY)
+    for (int s = 0; s < 2; s++)
+      for (int from = 0; from < 64; from++)
+	for (int to = 0; to < 64; to++)
+	  history[s][from][to] /= 2;
+}
+
+
+//! Forget which quiet moves caused cut offs
+void Search::clearHistory(void) {
+  for (int side = 0; side < 2; side++)
+    for (int from = 0; from < 64; from++)
+      for (int to = 0; to < 64; to++)
+	history[side][from][to] = 0;
+}
+
+
+//! Fill the history table with small pseudo-random values, so quiet moves that never cut off are tried in an order of its own.
+/** Lazy SMP helper threads do this with different seeds, so they do not all search the tree in the same order.
+ *  @param seed selects the order, any seed gives another one
+ */
+void Search::seedHistory(unsigned int seed) {
+  u_int32_t random = seed * 2654435761U + 1;
+
+  for (int side = 0; side < 2; side++)
+    for (int from = 0; from < 64; from++)
+      for (int to = 0; to < 64; to++) {
+	random = random * 1103515245U + 12345;
+	history[side][from][to] = (random >> 16) & 15;
+      }
+}
+
+
 double Search::alphaBeta(brd::Board* vBoard, double alpha, double beta, int depth = 5) {
   const double infinity = vBoard->getPieceValue(INFINITY);
-  double score = 0, bestScore = -infinity;
-  int leftOuts = 0;
-  brd::Board newVBoard;
+  double score = 0, bestScore = -infinity, alphaOrig = alpha;
+  double hashScore = 0;
+  int moveCount = 0, hashDepth = 0, hashBound = BOUND_NONE;
+  bool nullMoveAllowed = !afterNullMove, inCheck;
+  brd::PackedMove hashMove(0, 0), bestMove(0, 0), move;
+
+  if (ply < MAX_PLY)
+    pvLength[ply] = ply;
 
-  // If we have reached the 'leaves' of the game tree, return evaluation
+  // If we have reached the 'leaves' of the game tree, settle the captures and return evaluation
   if (depth <= 0) {
     Eval AI;
-    return AI.doEval(vBoard);
+    return quiesce(vBoard, alpha, beta, AI.doEval(vBoard));
+  }
+
+  nodes++;
+  afterNullMove = false;
+
+  // Use the stored result if this position has been searched deep enough before (but always search the root)
+  if (hashTable && hashTable->probe(vBoard->getHash(), hashMove, hashScore, hashDepth, hashBound) &&
+      ply > 0 && hashDepth >= depth) {
+    if (hashBound == BOUND_EXACT ||
+	(hashBound == BOUND_LOWER && hashScore >= beta) ||
+	(hashBound == BOUND_UPPER && hashScore <= alpha))
+      return hashScore;
   }
   
-  // Generate all possible moves
-  vBoard->genMoves();
-  
-  // Iterate through all generated moves
-  for (unsigned int i = 0; i < vBoard->getMoves().size() && bestScore < beta; i++) {
+  // The board the positions after each move are searched on, which leaves never need
+  brd::Board newVBoard;
+  inCheck = vBoard->isInCheck();
+
+  // Null move pruning: if the opponent cannot even reach beta when we pass, a real move will do at least as well.
+  // Passing is no option in check, and without pieces zugzwang is too common to trust it.
+  if (nullMoveAllowed && ply > 0 && depth > NULL_MOVE_REDUCTION && beta < infinity / 2 &&
+      vBoard->hasPieces(vBoard->getTurn()) && !inCheck) {
+    int reduction = depth > 6 ? NULL_MOVE_REDUCTION_DEEP : NULL_MOVE_REDUCTION;
+
+    vBoard->makeNullMove();
+    newVBoard.setBoard(vBoard->getBoard());
+    vBoard->undoNullMove();
 
-    // Use timer
-    if (clock.timeElapsed() >= maxTime)
+    ply++;
+    afterNullMove = true;
+    score = -alphaBeta(&newVBoard, -beta, -beta + NULL_WINDOW, depth - 1 - reduction);
+    afterNullMove = false;
+    ply--;
+
+    if (stopped)
+      return bestScore;
+
+    // Do not return a mate score that is based on passing
+    if (score >= beta)
+      return score >= infinity / 2 ? beta : score;
+  }
+
+  // Pick the moves one by one, the hash move and the captures first
+  int killerPly = ply < MAX_PLY ? ply : MAX_PLY - 1;
+  if (ply == 0 && rootMove != brd::PackedMove(0, 0))
+    hashMove = rootMove;
+  MovePicker picker(vBoard, hashMove, killers[killerPly][0], killers[killerPly][1], history[vBoard->getTurn()]);
+
+  while (bestScore < beta && picker.nextMove(move)) {
+    moveCount++;
+
+    // Stop if the time is up or another thread says so
+    if (isAborted())
       return bestScore;
     
-    // Do not allow illegal moves, such as those that would lead us right into check mate
-    if (!vBoard->isValidMove(vBoard->getArrayMove(i))) {
-      leftOuts++;
-      continue;
-    }
-    
-    vBoard->doArrayMove(i);
+    vBoard->makeMove(move);
     newVBoard.setBoard(vBoard->getBoard());
     vBoard->undoMove();
 
@@ -81,47 +257,691 @@ double Search::alphaBeta(brd::Board* vBoard, double alpha, double beta, int dept
     else
       newVBoard.setTurn(WHITE);
     
-    if (bestScore > alpha)
-      alpha = bestScore;
+    // Late quiet moves are unlikely to be good, search them less deep unless they check or evade a check
+    int reduction = 0;
+    if (depth >= LMR_MIN_DEPTH && moveCount >= LMR_MIN_MOVES && !inCheck && vBoard->isQuiet(move) &&
+	!newVBoard.isInCheck()) {
+      reduction = lmrReductions[depth < 64 ? depth : 63][moveCount < 64 ? moveCount : 63];
+      if (reduction > depth - 2)
+	reduction = depth - 2;
+    }
 
-    score = -alphaBeta(&newVBoard, -alpha-1, -alpha, depth - 1);
-    
-    // score = -alphaBeta(&newVBoard, -beta, -alpha, depth - 1);
+    // Principal variation search: the first move gets the full window, every other one only has to be shown
+    // not to be better, with a null window, and is searched again with the full window if it is
+    ply++;
+    if (moveCount == 1)
+      score = -alphaBeta(&newVBoard, -beta, -alpha, depth - 1);
+    else {
+      score = -alphaBeta(&newVBoard, -alpha - NULL_WINDOW, -alpha, depth - 1 - reduction);
 
-    if (score > alpha && score < beta)
-      score = -alphaBeta(&newVBoard, -beta, -alpha, depth-1);
+      // The reduced search did better than expected, so look again at full depth
+      if (reduction && score > alpha)
+	score = -alphaBeta(&newVBoard, -alpha - NULL_WINDOW, -alpha, depth - 1);
+
+      if (score > alpha && score < beta)
+	score = -alphaBeta(&newVBoard, -beta, -alpha, depth - 1);
+    }
+    ply--;
+
+    // The score of a search stopped half way through means nothing
+    if (stopped)
+      return bestScore;
 
     if (score > bestScore) {
       bestScore = score;
-      vBoard->setBestMove(vBoard->getArrayMove(i));
+      bestMove = move;
+
+      // Only the root sets the best move of its board, the boards below are thrown away anyway
+      if (ply == 0) {
+	rootMove = move;
+	vBoard->setBestMove(move);
 
 #ifdef DEBUG
-      cout << "Color: " << vBoard->getTurn() << " " << vBoard->getBestMove().source().x << ":" << vBoard->getBestMove().source().y << "-" <<
-	vBoard->getBestMove().dest().x << ":" << vBoard->getBestMove().dest().y << endl;
+	cout << "Color: " << vBoard->getTurn() << " " << vBoard->getBestMove().source().x << ":" << vBoard->getBestMove().source().y << "-" <<
+	  vBoard->getBestMove().dest().x << ":" << vBoard->getBestMove().dest().y << endl;
 #endif
+      }
+
+      // A new principal variation: this move followed by the one of the position after it
+      if (score > alpha) {
+	alpha = score;
+	if (ply + 1 < MAX_PLY) {
+	  pv[ply][ply] = move;
+	  for (int i = ply + 1; i < pvLength[ply + 1]; i++)
+	    pv[ply][i] = pv[ply + 1][i];
+	  pvLength[ply] = pvLength[ply + 1];
+	}
+      }
     }
     
-    /*
-      if (bestScore >= beta) { // Cut off
-      vBoard->setBestMove(vBoard->getArrayMove(i));
+    // Remember quiet moves that cut off, they are likely to do so again in sibling positions
+    if (bestScore >= beta && vBoard->isQuiet(move)) {
+      if (killers[killerPly][0] != move) {
+	killers[killerPly][1] = killers[killerPly][0];
+	killers[killerPly][0] = move;
       }
-    */
+      updateHistory(vBoard->getTurn(), move, depth);
+    }
+
+    // Young brothers wait: once the eldest move is searched, idle threads may help with its younger brothers
+    if (pool && pool->idle && ply > 0 && depth >= SPLIT_MIN_DEPTH && bestScore < beta &&
+	split(vBoard, &picker, alpha, beta, bestScore, bestMove, depth, moveCount, inCheck) && stopped)
+      return bestScore;
   }
   
-  // See whether we are check mate
-  if (leftOuts == (int)vBoard->getMoves().size())
+  // See whether we are check mate, without a legal move and not in check it is a draw
+  if (moveCount == 0) {
+    if (!inCheck) {
+      vBoard->setStalemate(true);
+      return DRAW_SCORE;
+    }
+    vBoard->setCheckmate(vBoard->getTurn());
+    return bestScore;
+  }
+
+  // Remember the result, unless the search has been stopped half way through
+  if (hashTable && !stopped) {
+    if (bestScore <= alphaOrig)
+      hashTable->store(vBoard->getHash(), bestMove, bestScore, depth, BOUND_UPPER);
+    else if (bestScore >= beta)
+      hashTable->store(vBoard->getHash(), bestMove, bestScore, depth, BOUND_LOWER);
+    else
+      hashTable->store(vBoard->getHash(), bestMove, bestScore, depth, BOUND_EXACT);
+  }
+
+  return bestScore;
+}
+
+
+//! Check whether the search has to stop.
+/** That is when the time is up, another thread has stopped the search or a split point this thread helps with
+ *  has been cut off. Once this is true, stopped stays set until the thread leaves the split point or the search.
+ */
+bool Search::isAborted(void) {
+  if (stopped)
+    return true;
+
+  if ((abortSearch && *abortSearch) || (useTimer && clock.timeElapsed() >= maxTime)) {
+    stopped = true;
+    if (abortSearch)
+      *abortSearch = true;
+    return true;
+  }
+
+  for (SplitPoint* sp = activeSplit; sp; sp = sp->parent)
+    if (sp->cutoff) {
+      stopped = true;
+      return true;
+    }
+
+  return false;
+}
+
+
+//! Share the remaining moves of a node with the idle worker threads and search them together.
+/** Returns when all moves are searched or one of them cut off, with the results of all threads merged into
+ *  alpha, bestScore, bestMove, moveCount and the principal variation of this ply.
+ *  @return false if no worker was idle any more, the moves are then left to the caller
+ */
+bool Search::split(brd::Board* vBoard, MovePicker* picker, double& alpha, double beta, double& bestScore,
+		   brd::PackedMove& bestMove, int depth, int& moveCount, bool inCheck) {
+  SplitPoint sp;
+
+  sp.parent = activeSplit;
+  sp.board = vBoard;
+  sp.picker = picker;
+  sp.alpha = alpha;
+  sp.beta = beta;
+  sp.bestScore = bestScore;
+  sp.bestMove = bestMove;
+  sp.depth = depth;
+  sp.ply = ply;
+  sp.moveCount = moveCount;
+  sp.inCheck = inCheck;
+  sp.helpers = 0;
+  sp.joinable = false;
+  sp.cutoff = false;
+  sp.pvLength = 0;
+  memcpy(sp.history, history[vBoard->getTurn()], sizeof(sp.history));
+  picker->setHistory(sp.history);
+  pthread_mutex_init(&sp.lock, 0);
+  pthread_cond_init(&sp.done, 0);
+
+  // The helpers may be done before we get here again, so count them while nobody can start yet
+  pthread_mutex_lock(&pool->lock);
+  for (int i = 0; i < pool->workerCount; i++)
+    if (!pool->work[i]) {
+      pool->work[i] = &sp;
+      pool->idle--;
+      sp.helpers++;
+    }
+  int helpers = sp.helpers;
+  if (helpers) {
+    pthread_cond_broadcast(&pool->wake);
+
+    // Open the split point, also to the masters of the split points above, which may be waiting for us
+    sp.nextOpen = pool->open;
+    pool->open = &sp;
+    for (SplitPoint* above = sp.parent; above; above = above->parent) {
+      pthread_mutex_lock(&above->lock);
+      above->joinable = true;
+      pthread_cond_signal(&above->done);
+      pthread_mutex_unlock(&above->lock);
+    }
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  // Another thread has taken the idle workers first
+  if (!helpers) {
+    picker->setHistory(history[vBoard->getTurn()]);
+    pthread_mutex_destroy(&sp.lock);
+    pthread_cond_destroy(&sp.done);
+    return false;
+  }
+
+  searchSplitPoint(&sp);
+
+  // There are no moves left to hand out, so nobody may join any more
+  pthread_mutex_lock(&pool->lock);
+  for (SplitPoint** link = &pool->open; *link; link = &(*link)->nextOpen)
+    if (*link == &sp) {
+      *link = sp.nextOpen;
+      break;
+    }
+  pthread_mutex_unlock(&pool->lock);
+
+  // Help the helpers until they are done, with the split points they open below this one. While there is none,
+  // keep an eye on the clock: once the time is up, isAborted() raises pool->abort, which stops them as well
+  while (true) {
+    pthread_mutex_lock(&sp.lock);
+    while (sp.helpers && !sp.joinable) {
+      struct timeval now;
+      struct timespec until;
+
+      gettimeofday(&now, 0);
+      until.tv_sec = now.tv_sec;
+      until.tv_nsec = (now.tv_usec + SPLIT_WAIT_MS * 1000) * 1000;
+      if (until.tv_nsec >= 1000000000) {
+	until.tv_sec++;
+	until.tv_nsec -= 1000000000;
+      }
+      pthread_cond_timedwait(&sp.done, &sp.lock, &until);
+      if (sp.helpers && !stopped)
+	isAborted();
+    }
+    sp.joinable = false;
+    helpers = sp.helpers;
+    pthread_mutex_unlock(&sp.lock);
+
+    if (!helpers)
+      break;
+    while (!stopped && !sp.cutoff && joinSplitPoint(&sp))
+      ;
+  }
+  pthread_mutex_destroy(&sp.lock);
+  pthread_cond_destroy(&sp.done);
+  picker->setHistory(history[vBoard->getTurn()]);
+
+  moveCount = sp.moveCount;
+  bestScore = sp.bestScore;
+  bestMove = sp.bestMove;
+  alpha = sp.alpha;
+  if (sp.pvLength) {
+    for (int i = ply; i < sp.pvLength; i++)
+      pv[ply][i] = sp.pv[i];
+    pvLength[ply] = sp.pvLength;
+  }
+
+  // A cut off of this split point only stopped the moves searched at the time, anything else stops the caller too
+  stopped = false;
+  if (isAborted())
+    return true;
+
+  if (sp.cutoff && vBoard->isQuiet(bestMove)) {
+    int killerPly = ply < MAX_PLY ? ply : MAX_PLY - 1;
+
+    if (killers[killerPly][0] != bestMove) {
+      killers[killerPly][1] = killers[killerPly][0];
+      killers[killerPly][0] = bestMove;
+    }
+    updateHistory(vBoard->getTurn(), bestMove, depth);
+  }
+
+  return true;
+}
+
+
+//! Search moves of a split point until there are none left or one of them cuts off.
+/** Called by the thread that split the node as well as by its helpers, each one on a copy of the board.
+ */
+void Search::searchSplitPoint(SplitPoint* sp) {
+  brd::Board board, newVBoard;
+  brd::PackedMove move;
+  SplitPoint* oldSplit = activeSplit;
+  int depth = sp->depth;
+  double score;
+
+  board.setBoard(sp->board->getBoard());
+  activeSplit = sp;
+  ply = sp->ply;
+  afterNullMove = false;
+
+  pthread_mutex_lock(&sp->lock);
+
+  while (!sp->cutoff && !stopped && sp->picker->nextMove(move)) {
+    int moveCount = ++sp->moveCount;
+    double alpha = sp->alpha, beta = sp->beta;
+
+    pthread_mutex_unlock(&sp->lock);
+
+    if (isAborted()) {
+      pthread_mutex_lock(&sp->lock);
+      break;
+    }
+
+    board.makeMove(move);
+    newVBoard.setBoard(board.getBoard());
+    board.undoMove();
+
+    if (board.getTurn() == WHITE)
+      newVBoard.setTurn(BLACK);
+    else
+      newVBoard.setTurn(WHITE);
+
+    // As in alphaBeta(), but every move here is a younger brother and gets a null window first
+    int reduction = 0;
+    if (depth >= LMR_MIN_DEPTH && moveCount >= LMR_MIN_MOVES && !sp->inCheck && board.isQuiet(move) &&
+	!newVBoard.isInCheck()) {
+      reduction = lmrReductions[depth < 64 ? depth : 63][moveCount < 64 ? moveCount : 63];
+      if (reduction > depth - 2)
+	reduction = depth - 2;
+    }
+
+    ply++;
+    score = -alphaBeta(&newVBoard, -alpha - NULL_WINDOW, -alpha, depth - 1 - reduction);
+    if (reduction && score > alpha)
+      score = -alphaBeta(&newVBoard, -alpha - NULL_WINDOW, -alpha, depth - 1);
+    if (score > alpha && score < beta)
+      score = -alphaBeta(&newVBoard, -beta, -alpha, depth - 1);
+    ply--;
+
+    pthread_mutex_lock(&sp->lock);
+
+    if (stopped)
+      break;
+
+    if (score > sp->bestScore) {
+      sp->bestScore = score;
+      sp->bestMove = move;
+
+      if (score > sp->alpha) {
+	sp->alpha = score;
+	if (ply + 1 < MAX_PLY) {
+	  sp->pv[ply] = move;
+	  for (int i = ply + 1; i < pvLength[ply + 1]; i++)
+	    sp->pv[i] = pv[ply + 1][i];
+	  sp->pvLength = pvLength[ply + 1];
+	}
+      }
+
+      if (score >= sp->beta)
+	sp->cutoff = true;
+    }
+  }
+
+  pthread_mutex_unlock(&sp->lock);
+  activeSplit = oldSplit;
+}
+
+
+//! Help with a split point below one this thread is the master of, while the helpers of that one are busy.
+/** Only split points that the helpers, or helpers of theirs, have opened are joined. These are done before sp is,
+ *  so this thread is back in time to finish sp.
+ *  @return false if there was no split point to join
+ */
+bool Search::joinSplitPoint(SplitPoint* sp) {
+  SplitPoint* below = 0;
+  int oldPly = ply;
+
+  // The master of the split point cannot close it while the pool is locked, so count us in first
+  pthread_mutex_lock(&pool->lock);
+  for (SplitPoint* open = pool->open; open && !below; open = open->nextOpen)
+    for (SplitPoint* above = open->parent; above; above = above->parent)
+      if (above == sp) {
+	below = open;
+	pthread_mutex_lock(&below->lock);
+	below->helpers++;
+	pthread_mutex_unlock(&below->lock);
+	break;
+      }
+  pthread_mutex_unlock(&pool->lock);
+
+  if (!below)
+    return false;
+
+  searchSplitPoint(below);
+  ply = oldPly;
+
+  pthread_mutex_lock(&below->lock);
+  if (--below->helpers == 0)
+    pthread_cond_signal(&below->done);
+  pthread_mutex_unlock(&below->lock);
+
+  // A cut off below only stopped the moves searched there
+  stopped = false;
+  isAborted();
+  return true;
+}
+
+
+//! Wait for split points to help with, until the pool is shut down. This is what the worker threads run.
+void Search::idleLoop(void) {
+  pthread_mutex_lock(&pool->lock);
+
+  while (!pool->quit) {
+    SplitPoint* sp = pool->work[workerId];
+
+    if (!sp) {
+      pthread_cond_wait(&pool->wake, &pool->lock);
+      continue;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    stopped = false;
+    searchSplitPoint(sp);
+    stopped = false;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->work[workerId] = 0;
+    pool->idle++;
+    pthread_mutex_unlock(&pool->lock);
+
+    // The master may leave, and sp be gone, as soon as the last helper is done
+    pthread_mutex_lock(&sp->lock);
+    if (--sp->helpers == 0)
+      pthread_cond_signal(&sp->done);
+    pthread_mutex_unlock(&sp->lock);
+
+    pthread_mutex_lock(&pool->lock);
+  }
+
+  pthread_mutex_unlock(&pool->lock);
+}
+
+
+//! Search the captures and promotions at the leaves of the game tree until the position is quiet.
+/** The side to move may stand pat, i.e. take the evaluation as it is, instead of capturing. The position is
+ *  evaluated just once, at the leaf of alphaBeta(), and every capture below adds the material it wins to that.
+ *  Captures that lose material (by their static exchange evaluation) and captures that cannot lift the score up
+ *  to alpha, even with a margin, are not searched at all.
+ *  A side in check cannot stand pat: all its legal moves are searched, and without one it is check mate.
+ *  @param vBoard is the position to search
+ *  @param alpha is the score the side to move is already sure of
+ *  @param beta is the score the opponent is already sure of
+ *  @param standPat is the evaluation of the position, seen from the side to move
+ *  @return The score of the position, seen from the side to move
+ */
+double Search::quiesce(brd::Board* vBoard, double alpha, double beta, double standPat) {
+  const brd::Position& pos = vBoard->getBoard();
+  double bestScore = standPat, score, gain;
+  bool inCheck;
+  brd::PackedMove move, noMove(0, 0);
+
+  qnodes++;
+
+  if (ply >= MAX_PLY)
+    return standPat;
+
+  inCheck = vBoard->isInCheck();
+  if (inCheck)
+    bestScore = -vBoard->getPieceValue(INFINITY);
+  else if (standPat >= beta)
+    return standPat;
+  else if (standPat > alpha)
+    alpha = standPat;
+
+  brd::Board newVBoard;
+  MovePicker picker = inCheck ? MovePicker(vBoard, noMove, noMove, noMove) : MovePicker(vBoard);
+  int moveCount = 0;
+
+  while (bestScore < beta && picker.nextMove(move)) {
+    moveCount++;
+
+    if (move.type() == MOVE_ENPASSANT)
+      gain = vBoard->getPieceValue(PAWN);
+    else if (pos.square[move.dest()].getPiece() != EMPTY)
+      gain = vBoard->getPieceValue(pos.square[move.dest()].getPiece());
+    else
+      gain = 0;
+
+    // Delta pruning, promotions are always worth a look and every evasion has to be
+    if (move.type() == MOVE_PROMOTION)
+      gain += vBoard->getPieceValue(move.promotion()) - vBoard->getPieceValue(PAWN);
+    else if (!inCheck && standPat + gain + DELTA_MARGIN * vBoard->getPieceValue(PAWN) <= alpha)
+      continue;
+
+    vBoard->makeMove(move);
+    newVBoard.setBoard(vBoard->getBoard());
+    vBoard->undoMove();
+    newVBoard.setTurn(vBoard->getTurn() == WHITE ? BLACK : WHITE);
+
+    ply++;
+    score = -quiesce(&newVBoard, -beta, -alpha, -(standPat + gain));
+    ply--;
+
+    if (score > bestScore) {
+      bestScore = score;
+      if (score > alpha)
+	alpha = score;
+    }
+  }
+
+  if (inCheck && moveCount == 0)
     vBoard->setCheckmate(vBoard->getTurn());
 
   return bestScore;
 }
 
 
+//! Return the principal variation of the deepest iteration iterativeDeepening() has completed.
+/** @param moves is cleared and then filled with the moves expected from both sides, starting with the best move
+ */
+void Search::getPrincipalVariation(brd::MoveList& moves) {
+  moves.clear();
+  for (int i = 0; i < rootPVLength; i++)
+    moves.push_back(rootPV[i]);
+}
+
+
+//! A helper thread of a parallel search, with a board and a search of its own.
+class SearchHelper {
+public:
+  Search search;
+  brd::Board board;
+  int maxDepth;
+  pthread_t thread;
+};
+
+
+static void* helperThread(void* arg) {
+  SearchHelper* helper = (SearchHelper*)arg;
+
+  helper->search.iterativeDeepening(&helper->board, helper->maxDepth);
+  return 0;
+}
+
+
+static void* workerThread(void* arg) {
+  ((Search*)arg)->idleLoop();
+  return 0;
+}
+
+
+//! Search a position to increasing depths until the maximum depth is reached or the time is up.
+/** Every iteration starts with the best move of the one before and, from the second iteration on, with a narrow
+ *  window around its score. If the score falls outside the window, the iteration is repeated with a wider one.
+ *  Iterations up to minDepth are always completed, deeper ones are stopped as soon as maxTime has passed.
+ *  With more than one thread (lazy SMP), helper threads search the same position on copies of the board at the
+ *  same time and share their results through the transposition table only. Every other helper searches one ply
+ *  deeper, and each one starts with a history table seeded differently, so they search different parts of the
+ *  tree from the start. They are stopped as soon as the calling thread is done.
+ *  In PARALLEL_YBWC mode the other threads wait in a pool instead, until a node has its first move searched and
+ *  its other moves can be shared (see split()).
+ *  @param vBoard is the position to search, its best move is set to the result of the deepest completed iteration
+ *  @param maxDepth is the depth of the last iteration
+ *  @return The score of the deepest completed iteration, seen from the side to move
+ *  @see setMinDepth()
+ *  @see setMaxTime()
+ */
+double Search::iterativeDeepening(brd::Board* vBoard, int maxDepth) {
+  const double infinity = vBoard->getPieceValue(INFINITY);
+  double score = 0, bestScore = 0, alpha, beta, delta;
+  brd::PackedMove bestMove(0, 0);
+  SearchHelper* helpers[MAX_SEARCH_THREADS];
+  volatile bool abortHelpers = false;
+  volatile bool* oldAbort = abortSearch;
+
+  rootMove = brd::PackedMove(0, 0);
+  rootPVLength = 0;
+  stopped = false;
+
+  // Without a shared transposition table the helpers could not help
+  int helperCount = parallelMode == PARALLEL_LAZY && hashTable ? threads - 1 : 0;
+  for (int i = 0; i < helperCount; i++) {
+    void* memory = 0;
+
+    // The board has to start at a cache line, which plain new does not promise
+    if (posix_memalign(&memory, CACHE_LINE_SIZE, sizeof(SearchHelper)) != 0) {
+      helperCount = i;
+      break;
+    }
+    helpers[i] = new (memory) SearchHelper;
+    helpers[i]->board = *vBoard;
+    helpers[i]->maxDepth = maxDepth;
+    helpers[i]->search.hashTable = hashTable;
+    helpers[i]->search.maxTime = 1e10;
+    helpers[i]->search.depthOffset = i & 1;
+    helpers[i]->search.seedHistory(i + 1);
+    helpers[i]->search.abortSearch = &abortHelpers;
+    pthread_create(&helpers[i]->thread, 0, helperThread, helpers[i]);
+  }
+
+  if (parallelMode == PARALLEL_YBWC && threads > 1) {
+    pool = new SearchPool;
+    pthread_mutex_init(&pool->lock, 0);
+    pthread_cond_init(&pool->wake, 0);
+    pool->workerCount = threads - 1;
+    pool->idle = pool->workerCount;
+    pool->open = 0;
+    pool->abort = false;
+    pool->quit = false;
+    abortSearch = &pool->abort;
+
+    for (int i = 0; i < pool->workerCount; i++) {
+      Search* worker = new Search;
+
+      worker->hashTable = hashTable;
+      worker->useTimer = false;
+      worker->pool = pool;
+      worker->workerId = i;
+      worker->abortSearch = &pool->abort;
+      pool->workers[i] = worker;
+      pool->work[i] = 0;
+      pthread_create(&pool->threads[i], 0, workerThread, worker);
+    }
+  }
+
+  for (int depth = 1; depth <= maxDepth && !stopped; depth++) {
+    useTimer = depth > minDepth;
+    delta = ASPIRATION_WINDOW * vBoard->getPieceValue(PAWN);
+
+    // Mate scores are too far apart for a window to help
+    if (depth > 1 && fabs(bestScore) < infinity / 2) {
+      alpha = bestScore - delta;
+      beta = bestScore + delta;
+    }
+    else {
+      alpha = -infinity;
+      beta = infinity;
+    }
+
+    while (true) {
+      score = alphaBeta(vBoard, alpha, beta, depth + depthOffset);
+      if (stopped)
+	break;
+
+      // Widen the window on the side the score fell out of and search again
+      if (score <= alpha && alpha > -infinity)
+	alpha = delta > vBoard->getPieceValue(QUEEN) ? -infinity : score - delta;
+      else if (score >= beta && beta < infinity)
+	beta = delta > vBoard->getPieceValue(QUEEN) ? infinity : score + delta;
+      else
+	break;
+      delta *= 2;
+    }
+
+    if (stopped)
+      break;
+
+    bestScore = score;
+    bestMove = rootMove;
+
+    rootPVLength = pvLength[0];
+    for (int i = 0; i < rootPVLength; i++)
+      rootPV[i] = pv[0][i];
+
+#ifdef DEBUG
+    cout << "Depth " << depth << ": " << bestScore << " (" << nodes << " nodes)" << endl;
+#endif
+  }
+
+  useTimer = true;
+
+  abortHelpers = true;
+  for (int i = 0; i < helperCount; i++) {
+    pthread_join(helpers[i]->thread, 0);
+    nodes += helpers[i]->search.nodes;
+    qnodes += helpers[i]->search.qnodes;
+    helpers[i]->~SearchHelper();
+    free(helpers[i]);
+  }
+
+  if (pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->workerCount; i++) {
+      pthread_join(pool->threads[i], 0);
+      nodes += pool->workers[i]->nodes;
+      qnodes += pool->workers[i]->qnodes;
+      delete pool->workers[i];
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    delete pool;
+    pool = 0;
+    abortSearch = oldAbort;
+  }
+
+  // An interrupted iteration may have left a move that is not even its own best
+  if (bestMove != brd::PackedMove(0, 0))
+    vBoard->setBestMove(bestMove);
+
+  return bestScore;
+}
+
+
 double Search::miniMax(brd::Board* vBoard, int depth = 3) {
   Eval AI;
-  brd::Board newVBoard;
   double score = 0;
   double bestScore = -(vBoard->getPieceValue(INFINITY));
-  int leftOuts = 0;
+  int moveCount = 0;
+  brd::MoveList moves;
+
+  nodes++;
 
   // Reached a leaf, do evaluation
   if (depth <= 0) {
@@ -129,24 +949,21 @@ double Search::miniMax(brd::Board* vBoard, int depth = 3) {
     return currentScore;
   }
 
+  brd::Board newVBoard;
+
   // Make sure it's the opponents turn when generating _new_ moves
   if (vBoard->getTurn() == WHITE)
     newVBoard.setTurn(BLACK);
   else
     newVBoard.setTurn(WHITE);
 
-  // Generate all possible moves in the current situation
-  vBoard->genMoves();
+  // Generate all legal moves in the current situation
+  vBoard->genLegalMoves(moves);
+  moveCount = moves.size();
   
-  for (unsigned int i = 0; i < vBoard->getMoves().size(); i++) {
-    // Do not allow illegal moves, such as those that lead right into check mate, etc.
-    if (!vBoard->isValidMove(vBoard->getArrayMove(i))) {
-      leftOuts++;
-      continue;
-    }
-    
+  for (int i = 0; i < moveCount; i++) {
     // Make a move...
-    vBoard->doArrayMove(i);
+    vBoard->makeMove(moves[i]);
     newVBoard.setBoard(vBoard->getBoard());
 
     // ...calculate the opponents score, according to the new board position
@@ -155,7 +972,7 @@ double Search::miniMax(brd::Board* vBoard, int depth = 3) {
     
     if (score > bestScore) {
       bestScore = score;
-      vBoard->setBestMove(vBoard->getArrayMove(i));
+      vBoard->setBestMove(moves[i]);
 
 #ifdef DEBUG
       cout << vBoard->getTurn() << ": "
@@ -170,9 +987,14 @@ double Search::miniMax(brd::Board* vBoard, int depth = 3) {
     }
   }
 
-  // See whether we are check mate
-  if (leftOuts == (int)vBoard->getMoves().size())
+  // See whether we are check mate, without a legal move and not in check it is a draw
+  if (moveCount == 0) {
+    if (!vBoard->isInCheck()) {
+      vBoard->setStalemate(true);
+      return DRAW_SCORE;
+    }
     vBoard->setCheckmate(vBoard->getTurn());
+  }
 
   return bestScore;
 }
@@ -186,3 +1008,30 @@ void Search::setMaxTime(double time) {
 void Search::setMinDepth(int depth) {
   minDepth = depth;
 }
+
+
+//! Set the number of threads iterativeDeepening() searches with, the calling thread included
+/** Lazy SMP helper threads share the transposition table, so without one only the calling thread searches. A
+ *  parallel search is timed by the wall clock, as the processor time of all threads adds up.
+ *  @see setParallelMode()
+ */
+void Search::setThreads(int count) {
+  threads = count < 1 ? 1 : (count > MAX_SEARCH_THREADS ? MAX_SEARCH_THREADS : count);
+  clock.setWallClock(threads > 1);
+}
+
+
+int Search::getThreads(void) {
+  return threads;
+}
+
+
+//! Choose how several threads search together, PARALLEL_LAZY or PARALLEL_YBWC
+void Search::setParallelMode(int mode) {
+  parallelMode = mode;
+}
+
+
+int Search::getParallelMode(void) {
+  return parallelMode;
+}
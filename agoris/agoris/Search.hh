@@ -19,25 +19,149 @@
 #ifndef _SEARCH_HH_
 #define _SEARCH_HH_
 
+extern "C" {
+#include <pthread.h>
+}
 #include "Board.hh"
 #include "Timer.hh"
+#include "TransTable.hh"
+
+#define MAX_PLY 64
+#define ASPIRATION_WINDOW 0.5   // Half width of the first aspiration window, in pawns
+#define NULL_WINDOW 0.001       // Width of a window that only tells whether a score is above or below a bound
+#define MAX_HISTORY 1000000     // The history table is halved when an entry grows beyond this
+#define DELTA_MARGIN 2          // Captures that cannot bring the score this close to alpha are skipped, in pawns
+#define DRAW_SCORE 0            // Score of a stalemate, for either side
+
+// Depth reductions of the null move search, near the leaves and further up the tree
+#define NULL_MOVE_REDUCTION      2
+#define NULL_MOVE_REDUCTION_DEEP 3
+
+// Late move reductions start with this move at this depth, the amount comes from a table
+#define LMR_MIN_DEPTH 3
+#define LMR_MIN_MOVES 4
+
+// Most threads one search may use, the calling thread included
+#define MAX_SEARCH_THREADS 64
+
+// How several threads search together
+#define PARALLEL_LAZY 0         // Helper threads search the whole tree, sharing the transposition table
+#define PARALLEL_YBWC 1         // Threads share the moves of nodes whose first move has been searched
+
+// Nodes with less depth left than this are not shared between threads, it would cost more than it saves
+#define SPLIT_MIN_DEPTH 4
+
+// Milliseconds between two looks at the clock while a split point waits for its helpers with nothing to join
+#define SPLIT_WAIT_MS 10
+
+class MovePicker;
+class Search;
+
+//! A node whose remaining moves are searched by several threads at once.
+/** The thread that found the node searches its first move on its own (the young brothers wait for their eldest)
+ *  and then shares the rest with idle threads. Everything below but the board and the move picker, which only the
+ *  split node reads, is guarded by lock. A cut off by any of the threads sets cutoff, which stops the others, also
+ *  in the nodes below further split points, as these check the chain of parents.
+ *  The picker orders the quiet moves by history, a copy of the table of the master thread, which goes on
+ *  updating its own table while the helpers pick moves.
+ */
+class SplitPoint {
+public:
+  pthread_mutex_t lock;
+  pthread_cond_t done;                   // Signalled when the last helper has left
+  SplitPoint* parent;                    // Split point the master thread was helping with, if any
+  brd::Board* board;
+  MovePicker* picker;
+  double alpha;
+  double beta;
+  double bestScore;
+  brd::PackedMove bestMove;
+  int depth;
+  int ply;
+  int moveCount;
+  bool inCheck;
+  int helpers;                           // Threads besides the master still searching moves of this node
+  bool joinable;                         // Set when a split point below was opened that the master may join
+  volatile bool cutoff;
+  SplitPoint* nextOpen;                  // Next split point in SearchPool::open
+  int history[64][64];
+  brd::PackedMove pv[MAX_PLY];           // Principal variation from the split node on, as far as pvLength
+  int pvLength;
+};
+
+//! The worker threads of a search that splits nodes (PARALLEL_YBWC).
+class SearchPool {
+public:
+  pthread_mutex_t lock;
+  pthread_cond_t wake;                   // Signalled when idle workers got a split point or should quit
+  int workerCount;
+  Search* workers[MAX_SEARCH_THREADS];
+  pthread_t threads[MAX_SEARCH_THREADS];
+  SplitPoint* work[MAX_SEARCH_THREADS];  // Split point each worker helps with, 0 while it is idle
+  SplitPoint* open;                      // Split points whose masters are still handing out moves
+  volatile int idle;                     // Number of idle workers
+  volatile bool abort;                   // Set when the time is up, to stop every thread
+  bool quit;
+};
 
 class Search {
 private:
   brd::Board* theBoard;
+  TransTable* hashTable;
   Timer clock;
   double maxTime;
   int minDepth;
+  long nodes;
+  long qnodes;
+  int ply;
+  bool useTimer;                         // False while an iteration up to minDepth is searched
+  bool stopped;                          // Set when the time is up in the middle of a search
+  bool afterNullMove;                    // Set while the first node after a null move is being entered
+  brd::PackedMove rootMove;              // Best move found so far at the root
+  brd::PackedMove killers[MAX_PLY][2];  // Quiet moves that caused a cut off, two per ply
+  int history[2][64][64];                // How well quiet moves did, per side, source and destination square
+  brd::PackedMove pv[MAX_PLY][MAX_PLY];  // Principal variation from each ply on, as a triangular table
+  int pvLength[MAX_PLY];                 // pv[ply] holds the moves up to pvLength[ply]
+  brd::PackedMove rootPV[MAX_PLY];       // Principal variation of the last completed iteration
+  int rootPVLength;
+  int threads;                           // Number of threads iterativeDeepening() searches with
+  int depthOffset;                       // Helper threads search this many plies deeper than asked, for variety
+  volatile bool* abortSearch;            // Set to stop all threads of a parallel search, 0 without helpers
+  int parallelMode;                      // PARALLEL_LAZY or PARALLEL_YBWC
+  SearchPool* pool;                      // Worker threads to split nodes with, if any
+  int workerId;                          // Index in pool of a worker thread
+  SplitPoint* activeSplit;               // Innermost split point this thread is searching moves of
+
+  void updateHistory(int, brd::PackedMove, int);
+  void seedHistory(unsigned int);
+  bool isAborted(void);
+  bool split(brd::Board*, MovePicker*, double&, double, double&, brd::PackedMove&, int, int&, bool);
+  void searchSplitPoint(SplitPoint*);
+  bool joinSplitPoint(SplitPoint*);
 
 public:
   Search();
   Search(brd::Board*);
   void initTimer(void);
   double alphaBeta(brd::Board*, double, double, int depth = 5);
+  double quiesce(brd::Board*, double, double, double);
+  double iterativeDeepening(brd::Board*, int);
   double miniMax(brd::Board*, int depth = 3);
   void setBoard(brd::Board*);
+  void setTransTable(TransTable*);
   void setMaxTime(double);
   void setMinDepth(int);
+  void setThreads(int);
+  int getThreads(void);
+  void setParallelMode(int);
+  int getParallelMode(void);
+  void idleLoop(void);
+  long getNodes(void);
+  long getQNodes(void);
+  void resetNodes(void);
+  void clearKillers(void);
+  void clearHistory(void);
+  void getPrincipalVariation(brd::MoveList&);
 };
 
 #endif
@@ -19,21 +19,5 @@
 #include "Square.hh"
 
 Square::Square() {
-  color = 0; piece = 0;
-}
-
-void Square::setColor(unsigned int newCol) {
-  color = newCol;
-}
-
-unsigned int Square::getColor(void) {
-  return color;
-}
-
-void Square::setPiece(unsigned int newPiece) {
-  piece = newPiece;
-}
-
-unsigned int Square::getPiece(void) {
-  return piece;
+  data = 0;
 }
@@ -30,17 +30,17 @@
 #endif
 #define INFINITY 7
 
+//! The piece on a square, packed into one byte as color << 3 | piece.
 class Square {
 private:
-  unsigned int color;
-  unsigned int piece;
+  unsigned char data;
 
 public:
   Square();
-  void setColor(unsigned int);
-  unsigned int getColor(void);
-  void setPiece(unsigned int);
-  unsigned int getPiece(void);
+  void setColor(unsigned int newCol) { data = (newCol << 3) | (data & 7); }
+  unsigned int getColor(void) const { return data >> 3; }
+  void setPiece(unsigned int newPiece) { data = (data & ~7) | newPiece; }
+  unsigned int getPiece(void) const { return data & 7; }
 };
 
 #endif
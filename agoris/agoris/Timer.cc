@@ -27,6 +27,7 @@ extern "C" {
 
 Timer::Timer() {
   start = 0;
+  wallClock = false;
 }
 
 
@@ -37,13 +38,28 @@ double Timer::cpuTime(void) {
 }
 
 
+//! Return the real time in seconds, as opposed to the CPU time used by the process
+double Timer::wallTime(void) {
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec + 1.0e-6*tv.tv_usec;
+}
+
+
+//! Measure real time instead of CPU time, which adds up over all threads of the process
+void Timer::setWallClock(bool wall) {
+  wallClock = wall;
+  resetTimer();
+}
+
+
 double Timer::timeElapsed(void) {
-  return cpuTime() - startTime();
+  return (wallClock ? wallTime() : cpuTime()) - startTime();
 }
 
 
 void Timer::resetTimer(void) {
-  start = cpuTime();
+  start = wallClock ? wallTime() : cpuTime();
 }
 
 
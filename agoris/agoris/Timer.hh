@@ -22,10 +22,13 @@
 class Timer {
 private:
   double start;
+  bool wallClock;
 
 public:
   Timer();
   double cpuTime(void);
+  double wallTime(void);
+  void setWallClock(bool);
   double startTime(void);
   double timeElapsed(void);
   void resetTimer(void);
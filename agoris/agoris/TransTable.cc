@@ -0,0 +1,158 @@
+// TransTable.cc - source file for the Agoris program
+// Copyright (c) 2001  Andreas Bauer <baueran@in.tum.de>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+// USA.
+
+extern "C" {
+#include <stdlib.h>
+#include <string.h>
+}
+#include "TransTable.hh"
+
+
+//! Create a table of the given size
+/** @param megabytes is the size of the table, rounded down to a power of two number of buckets
+ */
+TransTable::TransTable(int megabytes) {
+  buckets = 0;
+  bucketCount = 0;
+  generation = 0;
+  setSize(megabytes);
+}
+
+
+TransTable::~TransTable() {
+  free(buckets);
+}
+
+
+//! Change the size of the table, which also clears it
+/** @param megabytes is the new size of the table, rounded down to a power of two number of buckets
+ */
+void TransTable::setSize(int megabytes) {
+  u_int64_t count = 1;
+  void* memory = 0;
+
+  while (count * 2 * sizeof(TTBucket) <= (u_int64_t)megabytes * 1024 * 1024)
+    count *= 2;
+
+  free(buckets);
+  buckets = 0;
+  bucketCount = 0;
+
+  if (posix_memalign(&memory, sizeof(TTBucket), count * sizeof(TTBucket)) == 0) {
+    buckets = (TTBucket*)memory;
+    bucketCount = count;
+    clear();
+  }
+}
+
+
+//! Remove all entries from the table
+void TransTable::clear(void) {
+  memset(buckets, 0, bucketCount * sizeof(TTBucket));
+  generation = 0;
+}
+
+
+//! Call this before every new search, so entries from earlier searches are replaced first
+void TransTable::newSearch(void) {
+  generation = (generation + 1) & 63;
+}
+
+
+//! Look up a position in the table
+/** @param key is the hash key of the position
+ *  @param move is set to the best move found for the position, PackedMove(0, 0) if there is none
+ *  @param score is set to the score of the position
+ *  @param depth is set to the depth the position was searched with
+ *  @param bound is set to BOUND_EXACT, BOUND_LOWER or BOUND_UPPER, depending on what the score means
+ *  @return true if the position was found
+ */
+bool TransTable::probe(u_int64_t key, brd::PackedMove& move, double& score, int& depth, int& bound) {
+  if (!bucketCount)
+    return false;
+
+  TTBucket& bucket = buckets[key & (bucketCount - 1)];
+
+  for (int i = 0; i < TT_BUCKET_SIZE; i++) {
+    u_int32_t data = bucket.data[i];
+    u_int64_t scoreBits = bucket.score[i];
+
+    if (data && (bucket.key[i] ^ scoreBits ^ data) == key) {
+      memcpy(&score, &scoreBits, sizeof(score));
+      move.setData(data & 0xffff);
+      depth = (data >> 16) & 0xff;
+      bound = (data >> 24) & 3;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+//! Store the result of a search in the table
+/** If the position is not in its bucket yet, the entry with the lowest depth is replaced, entries from earlier
+ *  searches counting as much less deep.
+ *  @param key is the hash key of the position
+ *  @param move is the best move found, PackedMove(0, 0) to keep the move stored before
+ *  @param score is the score of the position
+ *  @param depth is the depth the position was searched with
+ *  @param bound is BOUND_EXACT, BOUND_LOWER or BOUND_UPPER
+ */
+void TransTable::store(u_int64_t key, brd::PackedMove move, double score, int depth, int bound) {
+  if (!bucketCount)
+    return;
+
+  TTBucket& bucket = buckets[key & (bucketCount - 1)];
+  int replace = 0;
+  int replaceValue = 1 << 30;
+
+  for (int i = 0; i < TT_BUCKET_SIZE; i++) {
+    u_int32_t data = bucket.data[i];
+
+    if (data && (bucket.key[i] ^ bucket.score[i] ^ data) == key) {
+      if (move == brd::PackedMove(0, 0))
+	move.setData(data & 0xffff);
+      replace = i;
+      break;
+    }
+
+    int age = (generation - (data >> 26)) & 63;
+    int value = data ? (int)((data >> 16) & 0xff) - 8 * age : -(1 << 20);
+
+    if (value < replaceValue) {
+      replace = i;
+      replaceValue = value;
+    }
+  }
+
+  u_int64_t scoreBits;
+  memcpy(&scoreBits, &score, sizeof(scoreBits));
+
+  if (depth < 0)
+    depth = 0;
+  else if (depth > 255)
+    depth = 255;
+
+  u_int32_t data = (u_int32_t)move.getData() | ((u_int32_t)depth << 16) | ((u_int32_t)bound << 24)
+    | ((u_int32_t)generation << 26);
+
+  bucket.data[replace] = data;
+  bucket.score[replace] = scoreBits;
+  bucket.key[replace] = key ^ scoreBits ^ data;
+}
@@ -0,0 +1,63 @@
+// TransTable.hh - source file for the Agoris program
+// Copyright (c) 2001  Andreas Bauer <baueran@in.tum.de>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+// USA.
+
+#ifndef _TRANSTABLE_HH_
+#define _TRANSTABLE_HH_
+
+#include "Board.hh"
+
+// Kinds of scores stored in the table
+#define BOUND_NONE  0
+#define BOUND_UPPER 1              // The score is at most this value
+#define BOUND_LOWER 2              // The score is at least this value
+#define BOUND_EXACT 3
+
+#define TT_BUCKET_SIZE 3           // Entries per bucket, so a bucket fits into one cache line
+
+//! A bucket of transposition table entries, one cache line.
+/** Entry i consists of key[i], score[i] and data[i]. score holds the bits of the score as a double: a float is
+ *  too coarse next to the king value that every score includes. data packs the best move (bits 0-15), the depth
+ *  (bits 16-23), the bound (bits 24-25) and the search the entry was written in (bits 26-31). key is the hash key
+ *  of the position XORed with score and data, so an entry torn apart by two threads writing at the same time is
+ *  simply not found again.
+ */
+class TTBucket {
+public:
+  u_int64_t key[TT_BUCKET_SIZE];
+  u_int64_t score[TT_BUCKET_SIZE];
+  u_int32_t data[TT_BUCKET_SIZE];
+} CACHE_ALIGNED;
+
+//! A hash table of search results, indexed by the Zobrist key of the position.
+class TransTable {
+private:
+  TTBucket* buckets;
+  u_int64_t bucketCount;
+  unsigned int generation;
+
+public:
+  TransTable(int megabytes = 16);
+  ~TransTable();
+  void setSize(int);
+  void clear(void);
+  void newSearch(void);
+  bool probe(u_int64_t, brd::PackedMove&, double&, int&, int&);
+  void store(u_int64_t, brd::PackedMove, double, int, int);
+};
+
+#endif
@@ -0,0 +1,72 @@
+// Zobrist.cc - source file for the Agoris program
+// Copyright (c) 2001  Andreas Bauer <baueran@in.tum.de>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+// USA.
+
+#include "Zobrist.hh"
+#include "Board.hh"
+
+namespace brd {
+
+  u_int64_t zobristPieces[2][6][64];
+  u_int64_t zobristSide;
+  u_int64_t zobristCastling[16];
+  u_int64_t zobristEnPassant[8];
+
+
+  //! Return the next number of a fixed xorshift sequence, so every run uses the same keys.
+  static u_int64_t nextRandom(void) {
+    static u_int64_t state = 0x9e3779b97f4a7c15ULL;
+
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545f4914f6cdd1dULL;
+  }
+
+
+  //! Fill the Zobrist keys. This is done once, when the library is loaded.
+  void initZobrist(void) {
+    for (int color = 0; color < 2; color++)
+      for (int piece = PAWN; piece <= KING; piece++)
+	for (int sq = 0; sq < 64; sq++)
+	  zobristPieces[color][piece][sq] = nextRandom();
+
+    zobristSide = nextRandom();
+
+    // Every castling right gets a key, a combination of rights the XOR of their keys
+    u_int64_t rights[4];
+    for (int i = 0; i < 4; i++)
+      rights[i] = nextRandom();
+    for (int flags = 0; flags < 16; flags++) {
+      zobristCastling[flags] = 0;
+      for (int i = 0; i < 4; i++)
+	if (flags & (1 << i))
+	  zobristCastling[flags] ^= rights[i];
+    }
+
+    for (int col = 0; col < 8; col++)
+      zobristEnPassant[col] = nextRandom();
+  }
+
+
+  // Make sure the keys are ready before the first board is set up
+  static class ZobristInit {
+  public:
+    ZobristInit() { initZobrist(); }
+  } zobristInit;
+
+}
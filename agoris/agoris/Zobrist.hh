@@ -0,0 +1,38 @@
+// Zobrist.hh - source file for the Agoris program
+// Copyright (c) 2001  Andreas Bauer <baueran@in.tum.de>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+// USA.
+
+#ifndef __ZOBRIST_HH_
+#define __ZOBRIST_HH_
+
+extern "C" {
+#include <sys/types.h>
+}
+
+namespace brd {
+
+  // Random keys, XORed together to give the hash key of a position
+  extern u_int64_t zobristPieces[2][6][64];      // Indexed by color, piece and square
+  extern u_int64_t zobristSide;                  // Present if black is to move
+  extern u_int64_t zobristCastling[16];          // Indexed by the CASTLING_* flags
+  extern u_int64_t zobristEnPassant[8];          // Indexed by the column of the en passant square
+
+  void initZobrist(void);
+
+}
+
+#endif
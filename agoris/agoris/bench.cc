@@ -0,0 +1,229 @@
+// bench.cc - source file for the Agoris program
+// Copyright (c) 2001  Andreas Bauer <baueran@in.tum.de>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+// USA.
+
+// agoris-bench: measures the throughput of the library's hot paths, so
+// the right settings can be chosen for each machine.
+
+#include <iostream>
+#include <string>
+#include <new>
+#include <algorithm>
+extern "C" {
+#include <stdlib.h>
+}
+#include "Attacks.hh"
+#include "Board.hh"
+#include "Search.hh"
+#include "Timer.hh"
+#include "TransTable.hh"
+
+using namespace std;
+using namespace brd;
+
+#define OCCUPANCIES 4096
+#define SMP_DEPTH 7        // Iterative deepening depth of the parallel search benchmark
+
+// Positions the parallel search is timed on
+const char* smpPositions[] = {
+  "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+  "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+  "r1bq1rk1/pp2bppp/2n2n2/2pp4/3P4/2PBPN2/PP1N1PPP/R2QK2R w KQ - 0 8",
+  0
+};
+
+// Prototypes
+void benchAttacks(int backend, const char* name, long rounds);
+template<int Backend> BitBoard lookupAttacks(long rounds);
+#ifdef HAVE_PEXT
+PEXT_INSTANCE BitBoard lookupPextAttacks(long rounds);
+#endif
+void benchSearch(int depth, TransTable* hashTable);
+void benchSmp(int depth, int maxThreads, int mode);
+
+
+// Random, reasonably sparse occupancies as they appear in real games
+BitBoard occupancy[OCCUPANCIES];
+
+// Number of heap allocations made by the whole program, library included
+long allocations = 0;
+
+
+// Count every allocation, so we can tell how many the search makes per node
+void* operator new(size_t size) {
+  void* p = malloc(size ? size : 1);
+
+  if (!p)
+    throw std::bad_alloc();
+  allocations++;
+  return p;
+}
+
+
+void operator delete(void* p) throw() {
+  free(p);
+}
+
+
+void operator delete(void* p, size_t) throw() {
+  free(p);
+}
+
+
+int main(int argc, char* argv[]) {
+  long rounds = 200;
+  int depth = 3;
+  int threads = 4;
+
+  if (argc > 1)
+    rounds = atol(argv[1]);
+  if (argc > 2)
+    depth = atoi(argv[2]);
+  if (argc > 3)
+    threads = atoi(argv[3]);
+
+  for (int i = 0; i < OCCUPANCIES; i++) {
+    BitBoard a = ((BitBoard)rand() << 33) ^ ((BitBoard)rand() << 11) ^ rand();
+    BitBoard b = ((BitBoard)rand() << 33) ^ ((BitBoard)rand() << 11) ^ rand();
+    occupancy[i] = a & b;
+  }
+
+  cout << "Slider attack lookups (" << rounds << " rounds)" << endl;
+  benchAttacks(ATTACKS_MAGIC, "magic", rounds);
+  if (isPextSupported())
+    benchAttacks(ATTACKS_PEXT, "pext", rounds);
+  else
+    cout << "  pext:  not supported on this CPU" << endl;
+
+  TransTable hashTable(16);
+  cout << "Alpha-beta search from the initial position (depth " << depth << ")" << endl;
+  benchSearch(depth, 0);
+  cout << "Alpha-beta search from the initial position with a 16 MB hash table (depth " << depth << ")" << endl;
+  benchSearch(depth, &hashTable);
+  cout << "Lazy SMP iterative deepening, time to depth " << SMP_DEPTH << " on " << (sizeof(smpPositions) /
+    sizeof(smpPositions[0]) - 1) << " positions" << endl;
+  benchSmp(SMP_DEPTH, threads, PARALLEL_LAZY);
+  cout << "Young brothers wait iterative deepening, time to depth " << SMP_DEPTH << " on " << (sizeof(smpPositions) /
+    sizeof(smpPositions[0]) - 1) << " positions" << endl;
+  benchSmp(SMP_DEPTH, threads, PARALLEL_YBWC);
+
+  return 0;
+}
+
+
+// Time rook and bishop attack lookups with one backend
+void benchAttacks(int backend, const char* name, long rounds) {
+  BitBoard sum;
+  Timer clock;
+  double lookups = 2.0 * 64 * OCCUPANCIES * rounds;
+
+  clock.setWallClock(true);
+
+#ifdef HAVE_PEXT
+  if (backend == ATTACKS_PEXT)
+    sum = lookupPextAttacks(rounds);
+  else
+#endif
+    sum = lookupAttacks<ATTACKS_MAGIC>(rounds);
+
+  double elapsed = clock.timeElapsed();
+  cout << "  " << name << ": " << (elapsed > 0 ? lookups / elapsed / 1e6 : 0) << " M lookups/s"
+       << " (checksum " << (sum & 0xffff) << ")" << endl;
+}
+
+
+// Look up rook and bishop attacks for every square and occupancy
+template<int Backend> BitBoard lookupAttacks(long rounds) {
+  BitBoard sum = 0;
+
+  for (long r = 0; r < rounds; r++)
+    for (int i = 0; i < OCCUPANCIES; i++)
+      for (int sq = 0; sq < 64; sq++)
+	sum += rookAttacks<Backend>(sq, occupancy[i]) ^ bishopAttacks<Backend>(sq, occupancy[i]);
+
+  return sum;
+}
+
+
+#ifdef HAVE_PEXT
+// The lookups with PEXT, compiled for BMI2
+BitBoard lookupPextAttacks(long rounds) {
+  return lookupAttacks<ATTACKS_PEXT>(rounds);
+}
+#endif
+
+
+// Search the initial position and report the node rate and heap allocations per node
+void benchSearch(int depth, TransTable* hashTable) {
+  Board board;
+  Search search;
+  Timer clock;
+  double infinity = board.getPieceValue(INFINITY);
+
+  search.setBoard(&board);
+  search.setTransTable(hashTable);
+  search.setMaxTime(1e9);
+  search.initTimer();
+  clock.setWallClock(true);
+  long startAllocations = allocations;
+
+  search.alphaBeta(&board, -infinity, infinity, depth);
+
+  double elapsed = clock.timeElapsed();
+  long nodes = search.getNodes() + search.getQNodes();
+  long allocs = allocations - startAllocations;
+
+  cout << "  nodes: " << nodes << " (" << search.getQNodes() << " in the quiescence search), "
+       << (elapsed > 0 ? nodes / elapsed : 0) << " nodes/s" << endl;
+  cout << "  allocs: " << allocs << ", " << (nodes > 0 ? (double)allocs / nodes : 0) << " allocs/node" << endl;
+}
+
+
+// Time iterative deepening to a fixed depth with 1, 2, 4, ... threads and report the speedup over one thread
+void benchSmp(int depth, int maxThreads, int mode) {
+  double oneThread = 0;
+
+  for (int threads = 1; threads > 0; threads = threads < maxThreads ? min(threads * 2, maxThreads) : 0) {
+    TransTable hashTable(16);
+    Timer clock;
+    long nodes = 0;
+
+    clock.setWallClock(true);
+
+    for (int i = 0; smpPositions[i]; i++) {
+      Board board;
+      Search search;
+
+      board.setFen(smpPositions[i]);
+      hashTable.clear();
+      search.setTransTable(&hashTable);
+      search.setThreads(threads);
+      search.setParallelMode(mode);
+      search.setMaxTime(1e9);
+      search.initTimer();
+      search.iterativeDeepening(&board, depth);
+      nodes += search.getNodes() + search.getQNodes();
+    }
+
+    double elapsed = clock.timeElapsed();
+    if (threads == 1)
+      oneThread = elapsed;
+
+    cout << "  threads: " << threads << ", " << elapsed << " s, speedup " << (elapsed > 0 ? oneThread / elapsed : 0)
+	 << ", " << (elapsed > 0 ? nodes / elapsed : 0) << " nodes/s" << endl;
+  }
+}
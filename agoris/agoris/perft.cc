@@ -0,0 +1,330 @@
+// perft.cc - source file for the Agoris program
+// Copyright (c) 2001  Andreas Bauer <baueran@in.tum.de>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+// USA.
+
+// agoris-perft: counts the leaf nodes of the legal move tree for a suite of
+// well known positions, to verify the move generator and to measure its speed.
+// It also checks that positions the move generator cannot handle are refused.
+
+#include <iostream>
+#include <string>
+extern "C" {
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+}
+#include "Board.hh"
+#include "Timer.hh"
+
+using namespace std;
+using namespace brd;
+
+#define MAX_THREADS 64
+#define MAX_REFERENCE_DEPTH 6
+
+// Standard positions and their published leaf counts for depths 1 to 6 (0 if not listed)
+struct PerftPosition {
+  const char* fen;
+  u_int64_t nodes[MAX_REFERENCE_DEPTH];
+};
+
+const PerftPosition suite[] = {
+  { "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    { 20, 400, 8902, 197281, 4865609, 119060324ULL } },
+  { "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    { 48, 2039, 97862, 4085603, 193690690ULL, 0 } },
+  { "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    { 14, 191, 2812, 43238, 674624, 11030083ULL } },
+  { "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    { 6, 264, 9467, 422333, 15833292ULL, 706045033ULL } },
+  { "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    { 44, 1486, 62379, 2103487, 89941194ULL, 0 } },
+  { "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    { 46, 2079, 89890, 3894594, 164075551ULL, 0 } }
+};
+
+#define SUITE_SIZE (int)(sizeof(suite) / sizeof(suite[0]))
+
+// Positions the move generators cannot handle, which Board::setFen() has to refuse
+const char* const refused[] = {
+  "8/8/8/8/8/8/8/4K3 w - - 0 1",                  // No black king
+  "4k3/8/8/8/8/8/8/4K3 x - - 0 1",                // No side to move
+  "4k3/8/8/8/8/8/8/4K3 w - e3 0 1",               // En passant without a pawn that has just moved
+  "4k3/8/8/8/8/8/8/R3K3 w KQ - 0 1",              // Castling without the h1 rook
+  "1k6/8/8/8/8/8/8/4K3 b q - 0 1",                // Castling with the king off e8
+  "4k3/8/8/8/8/8/4R3/4K3 w - - 0 1",              // The side not to move is in check
+  "4k3/8/8/8/8/8/8/4K3R w - - 0 1",               // Nine files on the first rank
+  "4k3/8/8/8/8/8/8/4K2 w - - 0 1",                // Seven files on the first rank
+  "4k3/8/8/8/8/8/8/8/4K3 w - - 0 1",              // Nine ranks
+  "4k3/8/8/8/8/8/4K3 w - - 0 1",                  // Seven ranks
+  "4k3/8/8/8/8/8/8/4K1KKKKKKKK w - - 0 1"         // Pieces past h1
+};
+
+#define REFUSED_SIZE (int)(sizeof(refused) / sizeof(refused[0]))
+
+
+//! A hash table of subtree counts, so transpositions are counted only once.
+/** Like the search's transposition table, every slot stores its key XORed with its data, so threads can share
+ *  the table without locks: a slot torn apart by two writers is simply not found.
+ */
+class PerftTable {
+private:
+  struct Slot {
+    u_int64_t key;
+    u_int64_t data;              // Leaf count in bits 0-55, depth in bits 56-63
+  };
+  Slot* slots;
+  u_int64_t slotCount;
+
+public:
+  PerftTable(int megabytes) {
+    slotCount = 0;
+    slots = 0;
+    if (megabytes > 0) {
+      slotCount = 1;
+      while (slotCount * 2 * sizeof(Slot) <= (u_int64_t)megabytes * 1024 * 1024)
+	slotCount *= 2;
+      slots = (Slot*)calloc(slotCount, sizeof(Slot));
+      if (!slots)
+	slotCount = 0;
+    }
+  }
+  ~PerftTable() { free(slots); }
+
+  bool probe(u_int64_t key, int depth, u_int64_t& nodes) {
+    if (!slotCount)
+      return false;
+    Slot& slot = slots[key & (slotCount - 1)];
+    u_int64_t data = slot.data;
+    if ((slot.key ^ data) != key || (int)(data >> 56) != depth)
+      return false;
+    nodes = data & 0x00ffffffffffffffULL;
+    return true;
+  }
+
+  void store(u_int64_t key, int depth, u_int64_t nodes) {
+    if (!slotCount)
+      return;
+    Slot& slot = slots[key & (slotCount - 1)];
+    u_int64_t data = nodes | ((u_int64_t)depth << 56);
+    slot.data = data;
+    slot.key = key ^ data;
+  }
+};
+
+
+// Everything the threads share while counting one position
+struct PerftJob {
+  Board* board;
+  MoveList rootMoves;
+  int nextMove;
+  int depth;
+  u_int64_t nodes;
+  PerftTable* table;
+  pthread_mutex_t lock;
+};
+
+
+// Prototypes
+u_int64_t hashPerft(Board& board, int depth, PerftTable* table);
+u_int64_t countPosition(Board& board, int depth, int threads, PerftTable* table);
+void* perftThread(void* arg);
+void usage(const char* name);
+
+
+int main(int argc, char* argv[]) {
+  int depth = 4, threads = 1, megabytes = 0, c;
+  bool divide = false, failed = false;
+  u_int64_t totalNodes = 0;
+  Timer total;
+
+  while ((c = getopt(argc, argv, "d:t:H:Dh")) != -1) {
+    switch (c) {
+    case 'd':
+      depth = atoi(optarg);
+      break;
+    case 't':
+      threads = atoi(optarg);
+      break;
+    case 'H':
+      megabytes = atoi(optarg);
+      break;
+    case 'D':
+      divide = true;
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (depth < 1 || threads < 1 || threads > MAX_THREADS || megabytes < 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  PerftTable table(megabytes);
+  total.setWallClock(true);
+
+  // Either the position given on the command line or the whole suite
+  bool fromSuite = optind >= argc;
+  int positions = fromSuite ? SUITE_SIZE : 1;
+
+  for (int i = 0; fromSuite && i < REFUSED_SIZE; i++) {
+    Board board;
+
+    if (board.setFen(refused[i])) {
+      cout << refused[i] << endl << "  FAILED (accepted a position that has to be refused)" << endl;
+      failed = true;
+    }
+  }
+
+  for (int i = 0; i < positions; i++) {
+    Board board;
+    Timer clock;
+    u_int64_t nodes;
+    string fen = fromSuite ? string(suite[i].fen) : string(argv[optind]);
+
+    if (!board.setFen(fen)) {
+      cerr << "Cannot read position: " << fen << endl;
+      return 1;
+    }
+
+    cout << fen << endl;
+    clock.setWallClock(true);
+    if (divide)
+      nodes = board.perftDivide(depth);
+    else
+      nodes = countPosition(board, depth, threads, &table);
+    double elapsed = clock.timeElapsed();
+
+    cout << "  depth " << depth << ": " << nodes << " nodes, " << elapsed << " s, "
+	 << (elapsed > 0 ? nodes / elapsed / 1e6 : 0) << " M nodes/s";
+    if (fromSuite && depth <= MAX_REFERENCE_DEPTH && suite[i].nodes[depth - 1]) {
+      if (nodes == suite[i].nodes[depth - 1])
+	cout << "  OK";
+      else {
+	cout << "  FAILED (expected " << suite[i].nodes[depth - 1] << ")";
+	failed = true;
+      }
+    }
+    cout << endl;
+
+    totalNodes += nodes;
+  }
+
+  double elapsed = total.timeElapsed();
+  cout << "Total: " << totalNodes << " nodes, " << elapsed << " s, "
+       << (elapsed > 0 ? totalNodes / elapsed / 1e6 : 0) << " M nodes/s" << endl;
+
+  return failed ? 1 : 0;
+}
+
+
+void usage(const char* name) {
+  cerr << "Usage: " << name << " [-d depth] [-t threads] [-H megabytes] [-D] [fen]" << endl
+       << "  -d depth      plies to count (default 4)" << endl
+       << "  -t threads    threads to share the moves of the root position (default 1)" << endl
+       << "  -H megabytes  size of the hash table for subtree counts (default 0, none)" << endl
+       << "  -D            print the count below every root move, single threaded and without hash table" << endl
+       << "  fen           count this position instead of the standard suite" << endl;
+}
+
+
+// Count a position, splitting its moves over several threads
+u_int64_t countPosition(Board& board, int depth, int threads, PerftTable* table) {
+  pthread_t thread[MAX_THREADS];
+  PerftJob job;
+
+  if (threads == 1 || depth == 1)
+    return hashPerft(board, depth, table);
+
+  job.board = &board;
+  job.nextMove = 0;
+  job.depth = depth;
+  job.nodes = 0;
+  job.table = table;
+  board.genLegalMoves(job.rootMoves);
+  pthread_mutex_init(&job.lock, 0);
+
+  for (int i = 0; i < threads; i++)
+    pthread_create(&thread[i], 0, perftThread, &job);
+  for (int i = 0; i < threads; i++)
+    pthread_join(thread[i], 0);
+
+  pthread_mutex_destroy(&job.lock);
+  return job.nodes;
+}
+
+
+// Take root moves from the job, one at a time, until all of them are counted
+void* perftThread(void* arg) {
+  PerftJob* job = (PerftJob*)arg;
+  Board board;
+  u_int64_t nodes = 0;
+  int side, move;
+
+  pthread_mutex_lock(&job->lock);
+  board.setBoard(job->board->getBoard());
+  pthread_mutex_unlock(&job->lock);
+  side = board.getTurn();
+
+  for (;;) {
+    pthread_mutex_lock(&job->lock);
+    move = job->nextMove++;
+    pthread_mutex_unlock(&job->lock);
+    if (move >= job->rootMoves.size())
+      break;
+
+    board.makeMove(job->rootMoves[move]);
+    board.setTurn(side == WHITE ? BLACK : WHITE);
+    nodes += hashPerft(board, job->depth - 1, job->table);
+    board.setTurn(side);
+    board.undoMove();
+  }
+
+  pthread_mutex_lock(&job->lock);
+  job->nodes += nodes;
+  pthread_mutex_unlock(&job->lock);
+  return 0;
+}
+
+
+// Board::perft() with a table of subtree counts
+u_int64_t hashPerft(Board& board, int depth, PerftTable* table) {
+  MoveList moves;
+  u_int64_t nodes = 0;
+  int side = board.getTurn();
+
+  if (depth <= 1)
+    return board.perft(depth);
+  if (table->probe(board.getHash(), depth, nodes))
+    return nodes;
+
+  board.genLegalMoves(moves);
+  for (int i = 0; i < moves.size(); i++) {
+    board.makeMove(moves[i]);
+    board.setTurn(side == WHITE ? BLACK : WHITE);
+    nodes += hashPerft(board, depth - 1, table);
+    board.setTurn(side);
+    board.undoMove();
+  }
+
+  table->store(board.getHash(), depth, nodes);
+  return nodes;
+}
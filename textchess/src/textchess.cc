@@ -99,11 +99,15 @@ int main() {
     // Use search depth of 5 (with a depth of 3 you usually get much faster results, but not as precise!)
     compMove = myChessGame.calculateMove(ALPHABETA, 5);
     
-    // Check for check mate
+    // Check for check mate or stale mate
     if (myChessGame.getCheckmate() == BLACK) {
       cout << "Computer is check mate. Congratulation, you won the game." << endl;
       return 0;
     }
+    else if (myChessGame.getStalemate()) {
+      cout << "Computer has no legal move left. Stalemate, the game is drawn." << endl;
+      return 0;
+    }
     else {
       myChessGame.makeMove(compMove);                 // Make move
       myChessGame.nextTurn();                         // Next turn